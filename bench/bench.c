@@ -0,0 +1,377 @@
+#include "image.h"
+#include "scene.h"
+#include "threadpool.h"
+
+// Micro benchmarks for the image and animation layer, run from the repository root
+// Results are printed as a table and written as tab separated values to the file given as the first argument
+
+#define VIDEO_WIDTH  240
+#define VIDEO_HEIGHT 180
+#define MAX_SAMPLES  1000
+// Below this many samples the 99th percentile is just the slowest sample, so only the max is reported
+#define MIN_P99_SAMPLES 200
+// Playhead states visited by isAnimationEnded in turn, a power of two so wrapping around is a mask
+#define PLAYHEAD_STATES 256
+
+typedef struct {
+    const char *name;
+    int warmup;
+    int samples;
+    int iterations; // Calls per sample, for functions too fast to time one call at a time
+} Benchmark;
+
+static SDL_Renderer *renderer;
+static SDL_Texture *renderTarget;
+static SDL_RWops *output;
+
+static const char *staticImages[] = {
+    "images/button_cook.webp",
+    "images/eyes_sheet.webp",
+    "images/ingredients_sheet.webp",
+};
+
+static const char *animations[] = {
+    "images/intro.webp",
+    "images/cooking_idle.webp",
+    "images/cooking_action.webp",
+    "images/cooking_end.webp",
+    "images/end_poisonous.webp",
+};
+
+static int compareSamples(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void runBenchmark(const Benchmark *benchmark, void (*function)(void *), void *data) {
+    static double samples[MAX_SAMPLES];
+    int sampleCount = SDL_min(benchmark->samples, MAX_SAMPLES);
+    double frequency = (double)SDL_GetPerformanceFrequency();
+
+    // The loaders log every call, keep that out of the timings and the results table
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN);
+    for (int i = 0; i < benchmark->warmup; i++) {
+        for (int j = 0; j < benchmark->iterations; j++) {
+            function(data);
+        }
+    }
+
+    for (int i = 0; i < sampleCount; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int j = 0; j < benchmark->iterations; j++) {
+            function(data);
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+        // Nanoseconds per call
+        samples[i] = (end - start) * 1e9 / frequency / benchmark->iterations;
+    }
+
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    SDL_qsort(samples, sampleCount, sizeof(double), compareSamples);
+    double min = samples[0];
+    double median = samples[sampleCount / 2];
+    double max = samples[sampleCount - 1];
+    char p99[32] = "-";
+    if (sampleCount >= MIN_P99_SAMPLES) {
+        SDL_snprintf(p99, sizeof(p99), "%.1f", samples[(sampleCount - 1) * 99 / 100]);
+    }
+    SDL_Log("%-52s %12.1f %12.1f %12s %12.1f", benchmark->name, min, median, p99, max);
+
+    if (output) {
+        char line[256];
+        int length = SDL_snprintf(line, sizeof(line), "%s\t%.1f\t%.1f\t%s\t%.1f\t%d\t%d\n",
+                                  benchmark->name, min, median, sampleCount >= MIN_P99_SAMPLES ? p99 : "", max, sampleCount, benchmark->iterations);
+        SDL_RWwrite(output, line, 1, length);
+    }
+}
+
+static void benchLoadImage(void *data) {
+    Arena *arena = createArena("bench");
+    StaticImage *image = loadImageWebp(renderer, arena, data);
+    if (image) {
+        freeImage(image);
+    }
+    freeArena(arena);
+}
+
+static void benchLoadAnimation(void *data) {
+    AnimatedImage *animation = loadAnimationWebp(renderer, data);
+    if (animation) {
+        freeAnimation(animation);
+    }
+}
+
+static void benchReadFile(void *data) {
+    size_t size;
+    SDL_free(readFile(data, &size));
+}
+
+typedef struct {
+    void *buffer;
+    size_t size;
+    Uint32 format;
+    DecodedAnimation decoded;
+} AnimationStages;
+
+static void benchDecodeAnimation(void *data) {
+    AnimationStages *stages = data;
+    DecodedAnimation decoded;
+    if (decodeAnimationWebp(stages->buffer, stages->size, stages->format, &decoded)) {
+        freeDecodedAnimation(&decoded);
+    }
+}
+
+static void benchUploadAnimation(void *data) {
+    AnimationStages *stages = data;
+    AnimatedImage *animation = uploadAnimation(renderer, &stages->decoded, "bench");
+    if (animation) {
+        freeAnimation(animation);
+    }
+}
+
+typedef struct {
+    AnimationPlayhead *playheads;
+    int count;
+    int delta;
+    int result;
+    int next; // Next of the prepared playhead states
+} AnimationUpdate;
+
+static void benchUpdateAnimation(void *data) {
+    AnimationUpdate *update = data;
+    update->result += updateAnimation(update->playheads, update->delta);
+}
+
+// The playhead states were advanced beforehand, so only the check itself is timed
+static void benchIsAnimationEnded(void *data) {
+    AnimationUpdate *update = data;
+    update->result += isAnimationEnded(&update->playheads[update->next], update->delta);
+    update->next = (update->next + 1) & (PLAYHEAD_STATES - 1);
+}
+
+static void benchUpdateAnimations(void *data) {
+    AnimationUpdate *update = data;
+    updateAnimations(update->playheads, update->count, update->delta);
+}
+
+typedef struct {
+    Scene scene;
+    Uint64 time;
+    int result;
+} FadeOut;
+
+static void benchProcessFadeOut(void *data) {
+    FadeOut *fadeOut = data;
+    // Walk through the whole fade out and start over
+    fadeOut->time = (fadeOut->time + 1) % 1600;
+    fadeOut->result += processFadeOut(&fadeOut->scene, fadeOut->scene.fadeOutStart + fadeOut->time);
+}
+
+typedef struct {
+    Scene *scene;
+    SceneSnapshot *snapshots[2];
+    int alternate;
+    int index;
+} SceneDraw;
+
+static void benchDrawScene(void *data) {
+    SceneDraw *draw = data;
+    if (draw->alternate) {
+        draw->index ^= 1;
+    }
+    SDL_SetRenderTarget(renderer, renderTarget);
+    draw->scene->draw(renderer, draw->scene, draw->snapshots[draw->index]);
+    SDL_RenderFlush(renderer);
+}
+
+static void benchRecreateTextures(void *data) {
+    Scene *scene = data;
+    recreateTextures(renderer);
+    scene->renderReset(scene);
+}
+
+static void benchImages(void) {
+    char name[128];
+    for (size_t i = 0; i < SDL_arraysize(staticImages); i++) {
+        SDL_snprintf(name, sizeof(name), "loadImageWebp %s", staticImages[i]);
+        Benchmark benchmark = { name, 5, 200, 1 };
+        runBenchmark(&benchmark, benchLoadImage, (void *)staticImages[i]);
+    }
+}
+
+static void benchAnimations(void) {
+    char name[128];
+    for (size_t i = 0; i < SDL_arraysize(animations); i++) {
+        const char *file = animations[i];
+        SDL_snprintf(name, sizeof(name), "loadAnimationWebp %s", file);
+        Benchmark benchmark = { name, 2, 20, 1 };
+        runBenchmark(&benchmark, benchLoadAnimation, (void *)file);
+
+        SDL_snprintf(name, sizeof(name), "loadAnimationWebp/read %s", file);
+        benchmark.samples = 200;
+        runBenchmark(&benchmark, benchReadFile, (void *)file);
+
+        AnimationStages stages;
+        stages.buffer = readFile(file, &stages.size);
+        stages.format = getNativePixelFormat(renderer);
+        if (!stages.buffer || !decodeAnimationWebp(stages.buffer, stages.size, stages.format, &stages.decoded)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't decode %s", file);
+            continue;
+        }
+
+        SDL_snprintf(name, sizeof(name), "loadAnimationWebp/decode %s", file);
+        benchmark.samples = 20;
+        runBenchmark(&benchmark, benchDecodeAnimation, &stages);
+
+        SDL_snprintf(name, sizeof(name), "loadAnimationWebp/upload %s", file);
+        runBenchmark(&benchmark, benchUploadAnimation, &stages);
+
+        freeDecodedAnimation(&stages.decoded);
+        SDL_free(stages.buffer);
+    }
+}
+
+static void benchAnimationUpdates(void) {
+    static const int deltas[] = { 1, 16, 33, 100, 1000, 10000 };
+    static const int playheadCounts[] = { 16, 256, 4096 };
+    char name[128];
+    AnimatedImage *animation = loadAnimationWebp(renderer, "images/cooking_idle.webp");
+    if (!animation) {
+        return;
+    }
+
+    AnimationPlayhead *states = SDL_malloc(sizeof(AnimationPlayhead) * PLAYHEAD_STATES);
+    for (size_t i = 0; i < SDL_arraysize(deltas); i++) {
+        AnimationPlayhead playhead;
+        AnimationUpdate update = { &playhead, 1, deltas[i], 0, 0 };
+        Benchmark benchmark = { name, 10, 200, 10000 };
+
+        initPlayhead(&playhead, animation, 0, animation->frameCount);
+        SDL_snprintf(name, sizeof(name), "updateAnimation delta=%d", deltas[i]);
+        runBenchmark(&benchmark, benchUpdateAnimation, &update);
+
+        // The states a playhead goes through when it is advanced by delta every frame
+        resetAnimation(&playhead);
+        for (int j = 0; j < PLAYHEAD_STATES; j++) {
+            states[j] = playhead;
+            updateAnimation(&playhead, deltas[i]);
+        }
+        AnimationUpdate check = { states, PLAYHEAD_STATES, deltas[i], 0, 0 };
+        SDL_snprintf(name, sizeof(name), "isAnimationEnded delta=%d", deltas[i]);
+        runBenchmark(&benchmark, benchIsAnimationEnded, &check);
+    }
+    SDL_free(states);
+
+    // Many sprites sharing one animation at different positions
+    for (size_t i = 0; i < SDL_arraysize(playheadCounts); i++) {
+        int count = playheadCounts[i];
+        AnimationPlayhead *playheads = SDL_malloc(sizeof(AnimationPlayhead) * count);
+        for (int j = 0; j < count; j++) {
+            initPlayhead(&playheads[j], animation, 0, animation->frameCount);
+            setAnimationFrame(&playheads[j], j % animation->frameCount);
+        }
+
+        AnimationUpdate update = { playheads, count, 16, 0, 0 };
+        Benchmark benchmark = { name, 10, 200, 100 };
+        SDL_snprintf(name, sizeof(name), "updateAnimations playheads=%d delta=16", count);
+        runBenchmark(&benchmark, benchUpdateAnimations, &update);
+        SDL_free(playheads);
+    }
+
+    freeAnimation(animation);
+}
+
+static void benchFadeOut(void) {
+    FadeOut fadeOut;
+    SDL_zero(fadeOut);
+    fadeOut.scene.fadeOutStart = 1;
+    Benchmark benchmark = { "processFadeOut", 10, 200, 10000 };
+    runBenchmark(&benchmark, benchProcessFadeOut, &fadeOut);
+}
+
+static void benchGameScene(void) {
+    Scene *scene = createGameScene(renderer);
+    if (!scene) {
+        return;
+    }
+
+    // Let a few ingredients come in, and take two snapshots with the eyes looking at different places
+    SceneDraw draw;
+    SDL_zero(draw);
+    draw.scene = scene;
+    draw.snapshots[0] = SDL_malloc(scene->snapshotSize);
+    draw.snapshots[1] = SDL_malloc(scene->snapshotSize);
+    Uint64 time = 0;
+    for (int i = 0; i < 300; i++) {
+        time += 16;
+        scene->update(scene, 16, time);
+    }
+    scene->snapshot(scene, draw.snapshots[0]);
+    for (int i = 0; i < 30; i++) {
+        time += 16;
+        scene->update(scene, 16, time);
+    }
+    scene->snapshot(scene, draw.snapshots[1]);
+
+    Benchmark benchmark = { "drawGameScene steady", 10, 500, 1 };
+    runBenchmark(&benchmark, benchDrawScene, &draw);
+
+    draw.alternate = 1;
+    benchmark.name = "drawGameScene changing";
+    runBenchmark(&benchmark, benchDrawScene, &draw);
+
+    // Every texture of the game scene, as after a render device reset
+    Benchmark recreate = { "recreateTextures game scene", 2, 20, 1 };
+    runBenchmark(&recreate, benchRecreateTextures, scene);
+
+    SDL_free(draw.snapshots[0]);
+    SDL_free(draw.snapshots[1]);
+    scene->free(scene);
+}
+
+int main(int argc, char *argv[]) {
+    if (SDL_Init(0) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't initialize SDL: %s", SDL_GetError());
+        return -1;
+    }
+    initThreadPool();
+    g_enableAudio = 0;
+
+    // Software renderer drawing into a surface, so the results don't depend on the GPU or a window
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, VIDEO_WIDTH, VIDEO_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888);
+    renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    renderTarget = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, VIDEO_WIDTH, VIDEO_HEIGHT) : NULL;
+    if (!renderTarget) {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create software renderer: %s", SDL_GetError());
+        return -1;
+    }
+
+    if (argc > 1) {
+        output = SDL_RWFromFile(argv[1], "wb");
+        if (!output) {
+            SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't open %s: %s", argv[1], SDL_GetError());
+            return -1;
+        }
+        const char *header = "name\tmin_ns\tmedian_ns\tp99_ns\tmax_ns\tsamples\titerations\n";
+        SDL_RWwrite(output, header, 1, SDL_strlen(header));
+    }
+
+    SDL_Log("%-52s %12s %12s %12s %12s", "benchmark (ns per call)", "min", "median", "p99", "max");
+    benchImages();
+    benchAnimations();
+    benchAnimationUpdates();
+    benchFadeOut();
+    benchGameScene();
+
+    if (output) {
+        SDL_RWclose(output);
+    }
+    SDL_DestroyTexture(renderTarget);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    quitThreadPool();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "arena.h"
+
+#define ARENA_CHUNK_SIZE 4096
+#define ARENA_ALIGN      16
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t size;
+    size_t used;
+};
+
+// Keep the data after the chunk header aligned
+#define ARENA_HEADER_SIZE ((sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+Arena *createArena(const char *name) {
+    Arena *arena = SDL_malloc(sizeof(Arena));
+    SDL_zerop(arena);
+    arena->name = name;
+    return arena;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size) {
+        // Allocations larger than a chunk get a chunk of their own
+        size_t chunkSize = SDL_max(size, ARENA_CHUNK_SIZE - ARENA_HEADER_SIZE);
+        chunk = SDL_malloc(ARENA_HEADER_SIZE + chunkSize);
+        if (!chunk) {
+            SDL_OutOfMemory();
+            return NULL;
+        }
+        chunk->size = chunkSize;
+        chunk->used = 0;
+
+        if (arena->chunks && chunkSize > ARENA_CHUNK_SIZE - ARENA_HEADER_SIZE) {
+            // Keep bump allocating from the current chunk after a large allocation
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        }
+        else {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+        arena->chunkCount++;
+    }
+
+    void *data = (Uint8 *)chunk + ARENA_HEADER_SIZE + chunk->used;
+    chunk->used += size;
+    arena->allocations++;
+    arena->bytes += size;
+
+    SDL_memset(data, 0, size);
+    return data;
+}
+
+void freeArena(Arena *arena) {
+    SDL_Log("Arena %s: %lu allocations, %lu bytes in %lu chunks", arena->name,
+            (unsigned long)arena->allocations, (unsigned long)arena->bytes, (unsigned long)arena->chunkCount);
+
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        SDL_free(chunk);
+        chunk = next;
+    }
+    SDL_free(arena);
+}
@@ -0,0 +1,21 @@
+#ifndef APP_ARENA_h
+#define APP_ARENA_h
+
+#include <SDL2/SDL.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+// Bump allocator for everything that lives as long as a scene, released all at once
+typedef struct {
+    const char *name;
+    ArenaChunk *chunks;
+    size_t chunkCount;
+    size_t allocations;
+    size_t bytes;
+} Arena;
+
+Arena *createArena(const char *name);
+void *arenaAlloc(Arena *arena, size_t size);
+void freeArena(Arena *arena);
+
+#endif
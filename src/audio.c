@@ -0,0 +1,385 @@
+#include <SDL2/SDL_mixer.h>
+#include "audio.h"
+
+#define CHANNELS      2
+#define FRAME_SIZE    (CHANNELS * sizeof(Sint16))
+#define RING_FRAMES   65536 // About 3 seconds at 22050 Hz, must be a power of two
+#define VOICES        2     // The current track and the one fading out under it
+#define CROSSFADE_MS  500
+#define FILL_INTERVAL 20    // The decode thread tops up the rings at least this often, in ms
+#define MAX_COMMANDS  8
+#define MAX_PATH      256
+
+typedef struct {
+    // Shared by the decode thread and the audio callback
+    Sint16 *ring;
+    SDL_atomic_t readPos;  // Frames consumed, only written by the callback
+    SDL_atomic_t writePos; // Frames produced, only written by the decode thread
+    SDL_atomic_t active;   // Set by the decode thread when the voice starts, cleared by the callback when it stops
+    SDL_atomic_t ended;    // The decode thread has written the last frame
+    SDL_atomic_t fadeOut;  // Requested fade out length in frames, taken by the callback
+
+    // Only touched by the callback while the voice is active, and by the decode thread while it isn't
+    float gain;
+    float gainStep;
+    float targetGain;
+    int fadeFramesLeft;
+    int stopAfterFade;
+
+    // Only touched by the decode thread
+    Mix_Chunk *chunk;
+    Uint32 chunkFrames;
+    Uint32 position;
+    int loop;
+    int finished;
+} Voice;
+
+typedef enum {
+    COMMAND_PLAY,
+    COMMAND_FADE_OUT,
+} AudioCommandType;
+
+typedef struct {
+    AudioCommandType type;
+    int loop;
+    int ms;
+    char file[MAX_PATH];
+} AudioCommand;
+
+static struct {
+    int frequency;
+    Voice voices[VOICES];
+    SDL_Thread *thread;
+    SDL_atomic_t pending;   // Tracks requested but not playing yet
+    SDL_atomic_t underruns;
+
+    // Commands for the decode thread, protected by the lock
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    int quit;
+    AudioCommand commands[MAX_COMMANDS];
+    int commandCount;
+} audio;
+
+static int msToFrames(int ms) {
+    return SDL_max((int)((Sint64)ms * audio.frequency / 1000), 1);
+}
+
+// Runs on the audio thread, must not allocate, lock or wait for anything
+static void audioCallback(void *data, Uint8 *stream, int len) {
+    Sint16 *out = (Sint16 *)stream;
+    Uint32 frames = len / FRAME_SIZE;
+
+    for (int v = 0; v < VOICES; v++) {
+        Voice *voice = &audio.voices[v];
+        if (!SDL_AtomicGet(&voice->active)) {
+            continue;
+        }
+        SDL_MemoryBarrierAcquire();
+
+        int fadeOut = SDL_AtomicSet(&voice->fadeOut, 0);
+        if (fadeOut > 0) {
+            voice->targetGain = 0;
+            voice->gainStep = -voice->gain / fadeOut;
+            voice->fadeFramesLeft = fadeOut;
+            voice->stopAfterFade = 1;
+        }
+
+        // Read the end flag first, so no frames written after it are missed
+        int ended = SDL_AtomicGet(&voice->ended);
+        Uint32 readPos = SDL_AtomicGet(&voice->readPos);
+        Uint32 available = (Uint32)SDL_AtomicGet(&voice->writePos) - readPos;
+        SDL_MemoryBarrierAcquire();
+
+        Uint32 count = SDL_min(frames, available);
+        int stopped = 0;
+        for (Uint32 i = 0; i < count; i++) {
+            const Sint16 *frame = voice->ring + ((readPos + i) & (RING_FRAMES - 1)) * CHANNELS;
+            for (int c = 0; c < CHANNELS; c++) {
+                int sample = out[i * CHANNELS + c] + (int)(frame[c] * voice->gain);
+                out[i * CHANNELS + c] = (Sint16)SDL_clamp(sample, -32768, 32767);
+            }
+
+            // Fades move the gain a little on every frame
+            if (voice->fadeFramesLeft > 0) {
+                voice->gain += voice->gainStep;
+                if (--voice->fadeFramesLeft == 0) {
+                    voice->gain = voice->targetGain;
+                    if (voice->stopAfterFade) {
+                        count = i + 1;
+                        stopped = 1;
+                        break;
+                    }
+                }
+            }
+        }
+        SDL_AtomicSet(&voice->readPos, readPos + count);
+
+        if (stopped || (ended && count == available)) {
+            // Hand the voice back to the decode thread
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSet(&voice->active, 0);
+        }
+        else if (count < frames) {
+            SDL_AtomicAdd(&audio.underruns, 1);
+        }
+    }
+}
+
+// Copy as many frames of the track as fit into the ring, wrapping around at the end of a looping track
+static void fillVoice(Voice *voice) {
+    Uint32 writePos = SDL_AtomicGet(&voice->writePos);
+    Uint32 space = RING_FRAMES - (writePos - (Uint32)SDL_AtomicGet(&voice->readPos));
+    const Sint16 *samples = (const Sint16 *)voice->chunk->abuf;
+
+    while (space > 0 && !voice->finished) {
+        Uint32 index = writePos & (RING_FRAMES - 1);
+        Uint32 count = SDL_min(space, voice->chunkFrames - voice->position);
+        count = SDL_min(count, RING_FRAMES - index);
+        SDL_memcpy(voice->ring + index * CHANNELS, samples + voice->position * CHANNELS, count * FRAME_SIZE);
+        writePos += count;
+        space -= count;
+        voice->position += count;
+
+        if (voice->position == voice->chunkFrames) {
+            // The loop continues on the very next frame, without a gap
+            if (voice->loop) {
+                voice->position = 0;
+            }
+            else {
+                voice->finished = 1;
+            }
+        }
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&voice->writePos, writePos);
+    if (voice->finished) {
+        SDL_AtomicSet(&voice->ended, 1);
+    }
+}
+
+// Free the tracks of the voices the callback has stopped, and top up the others
+static void serviceVoices(void) {
+    for (int v = 0; v < VOICES; v++) {
+        Voice *voice = &audio.voices[v];
+        if (!voice->chunk) {
+            continue;
+        }
+        if (!SDL_AtomicGet(&voice->active)) {
+            Mix_FreeChunk(voice->chunk);
+            voice->chunk = NULL;
+        }
+        else if (!voice->finished) {
+            fillVoice(voice);
+        }
+    }
+}
+
+static void fadeOutVoices(int frames) {
+    for (int v = 0; v < VOICES; v++) {
+        if (SDL_AtomicGet(&audio.voices[v].active)) {
+            SDL_AtomicSet(&audio.voices[v].fadeOut, frames);
+        }
+    }
+}
+
+static void startMusic(const char *file, int loop) {
+    // Decode the whole track here, so the callback only ever copies samples
+    SDL_RWops *rw = SDL_RWFromFile(file, "rb");
+    Mix_Chunk *chunk = rw ? Mix_LoadWAV_RW(rw, 1) : NULL;
+    if (!chunk || chunk->alen < FRAME_SIZE) {
+        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't load music %s: %s", file, Mix_GetError());
+        if (chunk) {
+            Mix_FreeChunk(chunk);
+        }
+        SDL_AtomicAdd(&audio.pending, -1);
+        return;
+    }
+
+    // Fade out what's playing and fade the new track in over it
+    int crossfade = 0;
+    for (int v = 0; v < VOICES; v++) {
+        crossfade |= SDL_AtomicGet(&audio.voices[v].active);
+    }
+    if (crossfade) {
+        fadeOutVoices(msToFrames(CROSSFADE_MS));
+    }
+
+    // With every voice busy, wait for one to fade out while keeping the others fed
+    Voice *voice = NULL;
+    for (;;) {
+        serviceVoices();
+        for (int v = 0; v < VOICES && !voice; v++) {
+            if (!audio.voices[v].chunk) {
+                voice = &audio.voices[v];
+            }
+        }
+        if (voice) {
+            break;
+        }
+        SDL_Delay(1);
+    }
+
+    // The callback doesn't look at an inactive voice, so it can be set up without synchronization
+    voice->chunk = chunk;
+    voice->chunkFrames = chunk->alen / FRAME_SIZE;
+    voice->position = 0;
+    voice->loop = loop;
+    voice->finished = 0;
+    SDL_AtomicSet(&voice->readPos, 0);
+    SDL_AtomicSet(&voice->writePos, 0);
+    SDL_AtomicSet(&voice->ended, 0);
+    SDL_AtomicSet(&voice->fadeOut, 0);
+    voice->stopAfterFade = 0;
+    voice->targetGain = 1;
+    if (crossfade) {
+        voice->fadeFramesLeft = msToFrames(CROSSFADE_MS);
+        voice->gain = 0;
+        voice->gainStep = 1.0f / voice->fadeFramesLeft;
+    }
+    else {
+        voice->fadeFramesLeft = 0;
+        voice->gain = 1;
+        voice->gainStep = 0;
+    }
+    fillVoice(voice);
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&voice->active, 1);
+    SDL_AtomicAdd(&audio.pending, -1);
+}
+
+static int decodeThread(void *data) {
+    // Keep the rings full even when the other threads are busy loading a scene
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    SDL_LockMutex(audio.lock);
+    while (!audio.quit) {
+        while (audio.commandCount > 0) {
+            AudioCommand command = audio.commands[0];
+            audio.commandCount--;
+            SDL_memmove(audio.commands, audio.commands + 1, audio.commandCount * sizeof(AudioCommand));
+            SDL_UnlockMutex(audio.lock);
+
+            if (command.type == COMMAND_PLAY) {
+                startMusic(command.file, command.loop);
+            }
+            else {
+                fadeOutVoices(msToFrames(command.ms));
+            }
+
+            SDL_LockMutex(audio.lock);
+        }
+        SDL_UnlockMutex(audio.lock);
+
+        serviceVoices();
+
+        SDL_LockMutex(audio.lock);
+        if (!audio.quit && audio.commandCount == 0) {
+            SDL_CondWaitTimeout(audio.wake, audio.lock, FILL_INTERVAL);
+        }
+    }
+    SDL_UnlockMutex(audio.lock);
+    return 0;
+}
+
+static void postCommand(const AudioCommand *command) {
+    if (!audio.thread) {
+        return;
+    }
+    SDL_LockMutex(audio.lock);
+    if (audio.commandCount < MAX_COMMANDS) {
+        audio.commands[audio.commandCount++] = *command;
+        if (command->type == COMMAND_PLAY) {
+            SDL_AtomicAdd(&audio.pending, 1);
+        }
+        SDL_CondSignal(audio.wake);
+    }
+    else {
+        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Too many audio commands");
+    }
+    SDL_UnlockMutex(audio.lock);
+}
+
+int openAudio(int frequency) {
+    // Don't allow any changes, SDL converts to whatever the device wants and the samples are always 16-bit stereo
+    if (Mix_OpenAudioDevice(frequency, AUDIO_S16SYS, CHANNELS, 4096, NULL, 0) < 0) {
+        return -1;
+    }
+    audio.frequency = frequency;
+    audio.lock = SDL_CreateMutex();
+    audio.wake = SDL_CreateCond();
+    for (int v = 0; v < VOICES; v++) {
+        audio.voices[v].ring = SDL_malloc(RING_FRAMES * FRAME_SIZE);
+    }
+    audio.thread = audio.lock && audio.wake ? SDL_CreateThread(decodeThread, "audio", NULL) : NULL;
+    if (!audio.thread) {
+        closeAudio();
+        return -1;
+    }
+
+    // Mix the voices where SDL mixer would mix its music
+    Mix_HookMusic(audioCallback, NULL);
+    return 0;
+}
+
+void closeAudio(void) {
+    if (audio.thread) {
+        // Waits for the callback to finish
+        Mix_HookMusic(NULL, NULL);
+
+        SDL_LockMutex(audio.lock);
+        audio.quit = 1;
+        SDL_CondSignal(audio.wake);
+        SDL_UnlockMutex(audio.lock);
+        SDL_WaitThread(audio.thread, NULL);
+        audio.thread = NULL;
+        SDL_LogInfo(SDL_LOG_CATEGORY_AUDIO, "Audio closed after %d buffer underruns", SDL_AtomicGet(&audio.underruns));
+    }
+
+    for (int v = 0; v < VOICES; v++) {
+        if (audio.voices[v].chunk) {
+            Mix_FreeChunk(audio.voices[v].chunk);
+        }
+        SDL_free(audio.voices[v].ring);
+    }
+    if (audio.wake) {
+        SDL_DestroyCond(audio.wake);
+    }
+    if (audio.lock) {
+        SDL_DestroyMutex(audio.lock);
+    }
+    SDL_zero(audio);
+    Mix_CloseAudio();
+}
+
+void playMusic(const char *file, int loop) {
+    AudioCommand command;
+    SDL_zero(command);
+    command.type = COMMAND_PLAY;
+    command.loop = loop;
+    SDL_strlcpy(command.file, file, sizeof(command.file));
+    postCommand(&command);
+}
+
+void fadeOutMusic(int ms) {
+    AudioCommand command;
+    SDL_zero(command);
+    command.type = COMMAND_FADE_OUT;
+    command.ms = ms;
+    postCommand(&command);
+}
+
+// Also true while a track is still loading, and while it's fading out
+int isMusicPlaying(void) {
+    if (SDL_AtomicGet(&audio.pending) > 0) {
+        return 1;
+    }
+    for (int v = 0; v < VOICES; v++) {
+        if (SDL_AtomicGet(&audio.voices[v].active)) {
+            return 1;
+        }
+    }
+    return 0;
+}
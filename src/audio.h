@@ -0,0 +1,14 @@
+#ifndef APP_AUDIO_h
+#define APP_AUDIO_h
+
+#include <SDL2/SDL.h>
+
+// Music player that decodes on its own thread and streams to the audio callback through ring buffers
+// The control functions can be called from any thread, but only from one at a time
+int openAudio(int frequency);
+void closeAudio(void);
+void playMusic(const char *file, int loop);
+void fadeOutMusic(int ms);
+int isMusicPlaying(void);
+
+#endif
@@ -1,7 +1,11 @@
 #include "image.h"
+#include "pack.h"
+#include "threadpool.h"
 #include <webp/demux.h>
 
-static void *readFile(const char *file, size_t *sizeOut) {
+#define BANDS_PER_THREAD 4
+
+void *readFile(const char *file, size_t *sizeOut) {
     SDL_RWops *fileRW = SDL_RWFromFile(file, "rb");
     if (!fileRW) {
         return NULL;
@@ -22,7 +26,58 @@ static void *readFile(const char *file, size_t *sizeOut) {
     return buffer;
 }
 
-StaticImage *loadImageWebp(SDL_Renderer *renderer, const char *file) {
+// Pick the byte order the renderer can use without converting on upload
+// Both formats store alpha in the last byte, the decoders only need to know which one to produce
+Uint32 getNativePixelFormat(SDL_Renderer *renderer) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+        for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+            if (info.texture_formats[i] == SDL_PIXELFORMAT_BGRA32 || info.texture_formats[i] == SDL_PIXELFORMAT_RGBA32) {
+                return info.texture_formats[i];
+            }
+        }
+    }
+    return SDL_PIXELFORMAT_RGBA32;
+}
+
+// Every image with textures, kept to recreate the textures when the render device is reset
+// The animations also serve as the cache that loadAnimationWebp looks up before loading a file again
+static StaticImage *liveImages;
+static AnimatedImage *liveAnimations;
+
+// FNV-1a over 32-bit words, the frames are only compared to the other frames of the same file
+static Uint64 hashFrame(const uint8_t *pixels, size_t size) {
+    const Uint32 *words = (const Uint32 *)pixels;
+    Uint64 hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size / 4; i++) {
+        hash ^= words[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// The pixels are tightly packed rows
+static Uint32 *packImage(const Uint32 *pixels, int width, int height) {
+    size_t count = (size_t)width * height;
+    Uint32 *packed = SDL_malloc(getPackBound(count) * 4);
+    size_t size = packPixels(pixels, NULL, count, packed);
+    return SDL_realloc(packed, size * 4);
+}
+
+static SDL_Texture *createTextureFromPixels(SDL_Renderer *renderer, Uint32 format, int access, int width, int height, const Uint32 *pixels) {
+    SDL_Texture *texture = SDL_CreateTexture(renderer, format, access, width, height);
+    if (!texture || SDL_UpdateTexture(texture, NULL, pixels, width * 4) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't create texture: %s", SDL_GetError());
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return texture;
+}
+
+static StaticImage *loadImage(SDL_Renderer *renderer, Arena *arena, const char *file, int withMask) {
     size_t fileSize;
     void *buffer = readFile(file, &fileSize);
     if (!buffer) {
@@ -31,37 +86,347 @@ StaticImage *loadImageWebp(SDL_Renderer *renderer, const char *file) {
     }
 
     int width, height;
-    uint8_t *rgba = WebPDecodeRGBA(buffer, fileSize, &width, &height);
-    if (!rgba) {
+    if (!WebPGetInfo(buffer, fileSize, &width, &height)) {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't decode image: %s", file);
+        SDL_free(buffer);
         return NULL;
     }
 
-    StaticImage *image = SDL_malloc(sizeof(StaticImage));
-    SDL_zerop(image);
+    StaticImage *image = arenaAlloc(arena, sizeof(StaticImage));
     image->width = width;
     image->height = height;
 
-    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, width, height);
-    if (!texture || SDL_UpdateTexture(texture, NULL, rgba, width * 4) < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create texture for image %s: %s", file, SDL_GetError());
+    // Decode into memory of our own, the locked texture memory is write-only and may be slow or undefined to read
+    Uint32 format = getNativePixelFormat(renderer);
+    int rgbaPitch = width * 4;
+    Uint8 *rgba = SDL_malloc((size_t)rgbaPitch * height);
+    uint8_t *decoded;
+    if (format == SDL_PIXELFORMAT_BGRA32) {
+        decoded = WebPDecodeBGRAInto(buffer, fileSize, rgba, (size_t)rgbaPitch * height, rgbaPitch);
+    }
+    else {
+        decoded = WebPDecodeRGBAInto(buffer, fileSize, rgba, (size_t)rgbaPitch * height, rgbaPitch);
+    }
+    SDL_free(buffer);
+    if (!decoded) {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't decode image: %s", file);
+        SDL_free(rgba);
+        return NULL;
+    }
+    if (withMask) {
+        image->mask = createAlphaMask(arena, rgba, rgbaPitch, width, height);
+    }
+    image->packed = packImage((const Uint32 *)rgba, width, height);
+
+    // The image never changes after loading
+    SDL_Texture *texture = createTextureFromPixels(renderer, format, SDL_TEXTUREACCESS_STATIC, width, height, (const Uint32 *)rgba);
+    SDL_free(rgba);
+    if (!texture) {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create texture for image %s", file);
+        SDL_free(image->packed);
         return NULL;
     }
-    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
     image->texture = texture;
-
-    WebPFree(rgba);
-    SDL_free(buffer);
+    image->format = format;
+    image->next = liveImages;
+    liveImages = image;
 
     return image;
 }
 
+StaticImage *loadImageWebp(SDL_Renderer *renderer, Arena *arena, const char *file) {
+    return loadImage(renderer, arena, file, 0);
+}
+
+// Also keep a bitmask of the opaque pixels
+StaticImage *loadMaskedImageWebp(SDL_Renderer *renderer, Arena *arena, const char *file) {
+    return loadImage(renderer, arena, file, 1);
+}
+
 void freeImage(StaticImage *image) {
+    StaticImage **link = &liveImages;
+    while (*link && *link != image) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = image->next;
+    }
+    SDL_free(image->packed);
     SDL_DestroyTexture(image->texture);
-    SDL_free(image);
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    int x;
+    int y;
+    int width;
+    int height;
+    int duration;
+    int disposeToBackground;
+    int blend;
+    int hasAlpha;
+    int isKeyFrame;
+} AnimationFrameInfo;
+
+typedef struct {
+    int width;
+    int height;
+    Uint32 format;
+    int frameCount;
+    const AnimationFrameInfo *frames;
+    Uint8 *canvases;
+    int bandHeight;
+    SDL_atomic_t failed;
+} AnimationDecodeJob;
+
+// Same rules as libwebp's anim_decode.c, a key frame can be decoded without any of the previous frames
+static int isAnimationKeyFrame(const AnimationFrameInfo *frame, const AnimationFrameInfo *prev, int width, int height) {
+    if (!prev) {
+        return 1;
+    }
+    if ((!frame->hasAlpha || !frame->blend) && frame->width == width && frame->height == height) {
+        // Full frame that covers everything below it
+        return 1;
+    }
+    return prev->disposeToBackground && ((prev->width == width && prev->height == height) || prev->isKeyFrame);
+}
+
+// Non-premultiplied alpha blending of src over dst, same integer arithmetic as libwebp
+static void blendPixel(Uint8 *src, const Uint8 *dst) {
+    int srcA = src[3];
+    if (srcA == 0) {
+        SDL_memcpy(src, dst, 4);
+        return;
+    }
+    int dstA = (dst[3] * (256 - srcA)) >> 8;
+    int blendA = srcA + dstA;
+    Uint32 scale = (1UL << 24) / blendA;
+    for (int i = 0; i < 3; i++) {
+        src[i] = ((Uint32)(src[i] * srcA + dst[i] * dstA) * scale) >> 24;
+    }
+    src[3] = blendA;
+}
+
+// Decoding a frame doesn't depend on the previous frames, only putting it together with them does
+// The fragment is decoded straight into its place on the frame's canvas
+static void decodeAnimationFragment(int index, void *data) {
+    AnimationDecodeJob *job = data;
+    const AnimationFrameInfo *frame = &job->frames[index];
+    int stride = job->width * 4;
+    size_t canvasSize = (size_t)stride * job->height;
+    size_t offset = (size_t)frame->y * stride + frame->x * 4;
+    uint8_t *pixels = job->canvases + canvasSize * index + offset;
+    uint8_t *decoded;
+    if (job->format == SDL_PIXELFORMAT_BGRA32) {
+        decoded = WebPDecodeBGRAInto(frame->data, frame->size, pixels, canvasSize - offset, stride);
+    }
+    else {
+        decoded = WebPDecodeRGBAInto(frame->data, frame->size, pixels, canvasSize - offset, stride);
+    }
+    if (!decoded) {
+        SDL_AtomicSet(&job->failed, 1);
+    }
+}
+
+// Fill in one row of a canvas around its decoded fragment from the same row of the previous canvas
+static void composeAnimationRow(const AnimationDecodeJob *job, int index, int y) {
+    const AnimationFrameInfo *frame = &job->frames[index];
+    const AnimationFrameInfo *prev = index > 0 ? frame - 1 : NULL;
+    int width = job->width;
+    size_t canvasSize = (size_t)width * job->height * 4;
+    Uint8 *row = job->canvases + canvasSize * index + (size_t)y * width * 4;
+
+    // The decoded fragment covers [left, right) of this row
+    int hasFragment = y >= frame->y && y < frame->y + frame->height;
+    int left = hasFragment ? frame->x : width;
+    int right = hasFragment ? frame->x + frame->width : width;
+
+    if (frame->isKeyFrame) {
+        SDL_memset(row, 0, left * 4);
+        SDL_memset(row + right * 4, 0, (width - right) * 4);
+        return;
+    }
+
+    // Start from the previous frame with its dispose method applied
+    const Uint8 *prevRow = row - canvasSize;
+    SDL_memcpy(row, prevRow, left * 4);
+    SDL_memcpy(row + right * 4, prevRow + right * 4, (width - right) * 4);
+    int isDisposed = prev->disposeToBackground && y >= prev->y && y < prev->y + prev->height;
+    int disposedLeft = isDisposed ? prev->x : 0;
+    int disposedRight = isDisposed ? prev->x + prev->width : 0;
+    if (isDisposed) {
+        int end = SDL_min(disposedRight, left);
+        if (disposedLeft < end) {
+            SDL_memset(row + disposedLeft * 4, 0, (end - disposedLeft) * 4);
+        }
+        int start = SDL_max(disposedLeft, right);
+        if (start < disposedRight) {
+            SDL_memset(row + start * 4, 0, (disposedRight - start) * 4);
+        }
+    }
+
+    if (frame->blend) {
+        for (int x = left; x < right; x++) {
+            // Pixels disposed by the previous frame are transparent, keep them without blending like libwebp does
+            int disposed = x >= disposedLeft && x < disposedRight;
+            if (!disposed && row[x * 4 + 3] != 255) {
+                blendPixel(row + x * 4, prevRow + x * 4);
+            }
+        }
+    }
+}
+
+// A canvas row only depends on the same row of the previous canvas, so every band of rows goes through the frames on its own
+static void composeAnimationBand(int band, void *data) {
+    AnimationDecodeJob *job = data;
+    int end = SDL_min((band + 1) * job->bandHeight, job->height);
+    for (int i = 0; i < job->frameCount; i++) {
+        for (int y = band * job->bandHeight; y < end; y++) {
+            composeAnimationRow(job, i, y);
+        }
+    }
+}
+
+void freeDecodedAnimation(DecodedAnimation *animation) {
+    SDL_free(animation->pixels);
+    SDL_free(animation->delays);
+}
+
+// Decode all frames into full canvases
+// The frames are decoded in parallel, then the canvases are completed in parallel bands of rows
+int decodeAnimationWebp(const void *buffer, size_t size, Uint32 format, DecodedAnimation *animation) {
+    WebPData webpData;
+    WebPDataInit(&webpData);
+    webpData.bytes = buffer;
+    webpData.size = size;
+    WebPDemuxer *demux = WebPDemux(&webpData);
+    if (!demux) {
+        return 0;
+    }
+
+    int width = WebPDemuxGetI(demux, WEBP_FF_CANVAS_WIDTH);
+    int height = WebPDemuxGetI(demux, WEBP_FF_CANVAS_HEIGHT);
+    int frameCount = WebPDemuxGetI(demux, WEBP_FF_FRAME_COUNT);
+    AnimationFrameInfo *frames = SDL_malloc(sizeof(AnimationFrameInfo) * frameCount);
+
+    WebPIterator iter;
+    int keyFrameCount = 0;
+    if (!WebPDemuxGetFrame(demux, 1, &iter)) {
+        WebPDemuxDelete(demux);
+        SDL_free(frames);
+        return 0;
+    }
+    for (int i = 0; i < frameCount; i++) {
+        AnimationFrameInfo *frame = &frames[i];
+        frame->data = iter.fragment.bytes;
+        frame->size = iter.fragment.size;
+        frame->x = iter.x_offset;
+        frame->y = iter.y_offset;
+        frame->width = iter.width;
+        frame->height = iter.height;
+        frame->duration = iter.duration;
+        frame->disposeToBackground = iter.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND;
+        frame->blend = iter.blend_method == WEBP_MUX_BLEND;
+        frame->hasAlpha = iter.has_alpha;
+        frame->isKeyFrame = isAnimationKeyFrame(frame, i > 0 ? frame - 1 : NULL, width, height);
+        keyFrameCount += frame->isKeyFrame;
+        WebPDemuxNextFrame(&iter);
+    }
+    WebPDemuxReleaseIterator(&iter);
+
+    AnimationDecodeJob job;
+    SDL_zero(job);
+    job.width = width;
+    job.height = height;
+    job.format = format;
+    job.frameCount = frameCount;
+    job.frames = frames;
+    job.canvases = SDL_malloc((size_t)width * height * 4 * frameCount);
+    parallelFor(frameCount, decodeAnimationFragment, &job);
+    if (!SDL_AtomicGet(&job.failed) && height > 0) {
+        int bandCount = SDL_min(getThreadPoolSize() * BANDS_PER_THREAD, height);
+        job.bandHeight = (height + bandCount - 1) / bandCount;
+        parallelFor((height + job.bandHeight - 1) / job.bandHeight, composeAnimationBand, &job);
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "Decoded %d frames, %d key frames", frameCount, keyFrameCount);
+
+    animation->width = width;
+    animation->height = height;
+    animation->frameCount = frameCount;
+    animation->format = format;
+    animation->pixels = job.canvases;
+    animation->delays = SDL_malloc(sizeof(int) * frameCount);
+    for (int i = 0; i < frameCount; i++) {
+        animation->delays[i] = frames[i].duration;
+    }
+
+    SDL_free(frames);
+    WebPDemuxDelete(demux);
+
+    if (SDL_AtomicGet(&job.failed)) {
+        freeDecodedAnimation(animation);
+        return 0;
+    }
+    return 1;
+}
+
+// Only one animation is prefetched at a time
+static struct {
+    const char *file;
+    SDL_Thread *thread;
+    DecodedAnimation decoded;
+    int success;
+} prefetch;
+
+static int prefetchThread(void *data) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    size_t fileSize;
+    void *buffer = readFile(prefetch.file, &fileSize);
+    if (buffer) {
+        // The renderer may not exist yet, guess the format most renderers use natively
+        prefetch.success = decodeAnimationWebp(buffer, fileSize, SDL_PIXELFORMAT_BGRA32, &prefetch.decoded);
+        SDL_free(buffer);
+    }
+    if (prefetch.success) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "Prefetched %s in %.1f ms", prefetch.file,
+                    (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+    return 0;
+}
+
+// Start decoding an animation on another thread, the next loadAnimationWebp of the same file waits for it and only uploads
+void prefetchAnimationWebp(const char *file) {
+    if (prefetch.thread) {
+        return;
+    }
+    prefetch.file = file;
+    prefetch.success = 0;
+    prefetch.thread = SDL_CreateThread(prefetchThread, "prefetch", NULL);
+    if (!prefetch.thread) {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't start prefetching %s: %s", file, SDL_GetError());
+    }
 }
 
 AnimatedImage *loadAnimationWebp(SDL_Renderer *renderer, const char *file) {
+    for (AnimatedImage *animation = liveAnimations; animation; animation = animation->next) {
+        if (animation->renderer == renderer && SDL_strcmp(animation->file, file) == 0) {
+            return retainAnimation(animation);
+        }
+    }
+
+    if (prefetch.thread && SDL_strcmp(prefetch.file, file) == 0) {
+        SDL_WaitThread(prefetch.thread, NULL);
+        prefetch.thread = NULL;
+        if (prefetch.success) {
+            AnimatedImage *image = uploadAnimation(renderer, &prefetch.decoded, file);
+            freeDecodedAnimation(&prefetch.decoded);
+            return image;
+        }
+        // Decode it again here to report the error
+    }
+
     size_t fileSize;
     void *buffer = readFile(file, &fileSize);
     if (!buffer) {
@@ -69,94 +434,238 @@ AnimatedImage *loadAnimationWebp(SDL_Renderer *renderer, const char *file) {
         return NULL;
     }
 
-    WebPData webpData;
-    WebPDataInit(&webpData);
-    webpData.bytes = buffer;
-    webpData.size = fileSize;
-    WebPAnimDecoder *webpDecoder = WebPAnimDecoderNew(&webpData, NULL);
-    if (!webpDecoder) {
+    // Let the decoder produce frames in the renderer's format, so uploading them is a plain copy
+    DecodedAnimation decoded;
+    int success = decodeAnimationWebp(buffer, fileSize, getNativePixelFormat(renderer), &decoded);
+    SDL_free(buffer);
+    if (!success) {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't decode image %s", file);
         return NULL;
     }
 
-    WebPAnimInfo webpInfo;
-    if (!WebPAnimDecoderGetInfo(webpDecoder, &webpInfo)) {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't get image info for %s", file);
-        return NULL;
+    AnimatedImage *image = uploadAnimation(renderer, &decoded, file);
+    freeDecodedAnimation(&decoded);
+    return image;
+}
+
+typedef struct {
+    const DecodedAnimation *decoded;
+    const int *uniqueFrames; // The frame each unique texture was created from
+    Uint32 **packedTextures;
+    size_t *packedSizes;
+} PackJob;
+
+static void packAnimationTexture(int index, void *data) {
+    PackJob *job = data;
+    size_t count = (size_t)job->decoded->width * job->decoded->height;
+    const Uint32 *pixels = (const Uint32 *)job->decoded->pixels + count * job->uniqueFrames[index];
+    const Uint32 *base = index > 0 ? (const Uint32 *)job->decoded->pixels + count * job->uniqueFrames[index - 1] : NULL;
+    Uint32 *packed = SDL_malloc(getPackBound(count) * 4);
+    size_t size = packPixels(pixels, base, count, packed);
+    job->packedTextures[index] = SDL_realloc(packed, size * 4);
+    job->packedSizes[index] = size * 4;
+}
+
+// Frees everything of an animation except the textures
+static void freeAnimationData(AnimatedImage *animation) {
+    if (animation->packedTextures) {
+        for (int i = 0; i < animation->textureCount; i++) {
+            SDL_free(animation->packedTextures[i]);
+        }
     }
+    SDL_free(animation->packedTextures);
+    SDL_free(animation->delays);
+    SDL_free(animation->textures);
+    SDL_free(animation->textureIndices);
+    SDL_free(animation->uniqueTextures);
+    SDL_free(animation->file);
+    SDL_free(animation);
+}
 
-    AnimatedImage *image = SDL_malloc(sizeof(AnimatedImage));
-    SDL_zerop(image);
+// Create the textures for the decoded frames, later loads of the same file with the same renderer share them
+// The caller holds the only reference
+AnimatedImage *uploadAnimation(SDL_Renderer *renderer, const DecodedAnimation *decoded, const char *file) {
+    AnimatedImage *image = SDL_calloc(1, sizeof(AnimatedImage));
 
-    int width = webpInfo.canvas_width;
-    int height = webpInfo.canvas_height;
-    int frames = webpInfo.frame_count;
+    int width = decoded->width;
+    int height = decoded->height;
+    int frames = decoded->frameCount;
+    size_t canvasSize = (size_t)width * height * 4;
     image->width = width;
     image->height = height;
     image->frameCount = frames;
     image->delays = SDL_malloc(sizeof(int) * frames);
-    image->textures = SDL_malloc(sizeof(SDL_Surface *) * frames);
-
-    int frame = 0;
-    int lastTimestamp = 0;
-    while (WebPAnimDecoderHasMoreFrames(webpDecoder)) {
-        int timestamp;
-        uint8_t *rgba;
-        if (!WebPAnimDecoderGetNext(webpDecoder, &rgba, &timestamp)) {
-            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't decode image %s frame %d", file, frame);
-            return NULL;
+    image->textures = SDL_malloc(sizeof(SDL_Texture *) * frames);
+    image->textureIndices = SDL_malloc(sizeof(int) * frames);
+    image->uniqueTextures = SDL_malloc(sizeof(SDL_Texture *) * frames);
+    image->format = decoded->format;
+    image->renderer = renderer;
+    image->file = SDL_strdup(file);
+    image->refCount = 1;
+    Uint64 *hashes = SDL_malloc(sizeof(Uint64) * frames);
+    int *uniqueFrames = SDL_malloc(sizeof(int) * frames);
+
+    for (int frame = 0; frame < frames; frame++) {
+        Uint8 *rgba = decoded->pixels + canvasSize * frame;
+
+        // Reuse the texture of an earlier frame with the same content, the hash only narrows down the candidates
+        Uint64 hash = hashFrame(rgba, canvasSize);
+        int index = -1;
+        for (int i = 0; i < image->textureCount; i++) {
+            if (hashes[i] == hash && SDL_memcmp(rgba, decoded->pixels + canvasSize * uniqueFrames[i], canvasSize) == 0) {
+                index = i;
+                break;
+            }
         }
 
-        SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, width, height);
-        if (!texture || SDL_UpdateTexture(texture, NULL, rgba, width * 4) < 0) {
-            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create texture for image %s frame %d: %s", file, frame, SDL_GetError());
-            return NULL;
+        if (index < 0) {
+            // Frames never change after loading
+            SDL_Texture *texture = SDL_CreateTexture(renderer, decoded->format, SDL_TEXTUREACCESS_STATIC, width, height);
+            if (!texture || SDL_UpdateTexture(texture, NULL, rgba, width * 4) < 0) {
+                SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create texture for image %s frame %d: %s", file, frame, SDL_GetError());
+                if (texture) {
+                    SDL_DestroyTexture(texture);
+                }
+                for (int i = 0; i < image->textureCount; i++) {
+                    SDL_DestroyTexture(image->uniqueTextures[i]);
+                }
+                freeAnimationData(image);
+                SDL_free(hashes);
+                SDL_free(uniqueFrames);
+                return NULL;
+            }
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            index = image->textureCount++;
+            hashes[index] = hash;
+            uniqueFrames[index] = frame;
+            image->uniqueTextures[index] = texture;
         }
-        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
 
-        image->textures[frame] = texture;
-        image->delays[frame] = timestamp - lastTimestamp;
+        image->textures[frame] = image->uniqueTextures[index];
+        image->textureIndices[frame] = index;
+        image->delays[frame] = decoded->delays[frame];
+    }
 
-        frame++;
-        lastTimestamp = timestamp;
+    // Keep the compact copies for recovering from a render device reset, every texture packs on its own
+    PackJob job = { decoded, uniqueFrames, SDL_malloc(sizeof(Uint32 *) * image->textureCount), SDL_malloc(sizeof(size_t) * frames) };
+    parallelFor(image->textureCount, packAnimationTexture, &job);
+    image->packedTextures = job.packedTextures;
+    size_t packedSize = 0;
+    for (int i = 0; i < image->textureCount; i++) {
+        packedSize += job.packedSizes[i];
     }
 
-    WebPAnimDecoderDelete(webpDecoder);
-    SDL_free(buffer);
+    SDL_Log("Loaded %s: %d frames, %d unique textures (%d%% deduplicated), %d KB packed copy",
+            file, frames, image->textureCount, frames ? (frames - image->textureCount) * 100 / frames : 0, (int)(packedSize / 1024));
 
-    resetAnimation(image);
+    SDL_free(job.packedSizes);
+    SDL_free(hashes);
+    SDL_free(uniqueFrames);
+
+    image->next = liveAnimations;
+    liveAnimations = image;
     return image;
 }
 
-void setAnimationFrame(AnimatedImage *animation, int frame) {
-    animation->currentFrame = frame;
-    animation->currentDelayLeft = animation->delays[frame];
+// Add an owner to an animation, every owner calls freeAnimation once
+AnimatedImage *retainAnimation(AnimatedImage *animation) {
+    animation->refCount++;
+    return animation;
 }
 
-void resetAnimation(AnimatedImage *animation) {
-    animation->currentFrame = 0;
-    animation->currentDelayLeft = animation->delays[0];
+// The last owner to let go destroys the textures
+void freeAnimation(AnimatedImage *animation) {
+    if (--animation->refCount > 0) {
+        return;
+    }
+    AnimatedImage **link = &liveAnimations;
+    while (*link && *link != animation) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = animation->next;
+    }
+
+    // Shared frames point to the same texture, only destroy each texture once
+    for (int i = 0; i < animation->textureCount; i++) {
+        SDL_DestroyTexture(animation->uniqueTextures[i]);
+    }
+    freeAnimationData(animation);
 }
 
-void freeAnimation(AnimatedImage *animation) {
-    for (int i = 0; i < animation->frameCount; i++) {
-        SDL_DestroyTexture(animation->textures[i]);
+// Returns the number of textures recreated, or -1 if any of them failed
+int recreateTextures(SDL_Renderer *renderer) {
+    int count = 0;
+    int failed = 0;
+
+    for (StaticImage *image = liveImages; image; image = image->next) {
+        size_t pixelCount = (size_t)image->width * image->height;
+        Uint32 *pixels = SDL_calloc(pixelCount, 4);
+        unpackPixels(image->packed, pixels, pixelCount);
+        SDL_DestroyTexture(image->texture);
+        image->texture = createTextureFromPixels(renderer, image->format, SDL_TEXTUREACCESS_STATIC, image->width, image->height, pixels);
+        failed |= !image->texture;
+        count++;
+        SDL_free(pixels);
     }
-    SDL_free(animation->delays);
-    SDL_free(animation->textures);
-    SDL_free(animation);
+
+    for (AnimatedImage *animation = liveAnimations; animation; animation = animation->next) {
+        // Every texture is packed against the one before, so unpacking them in order over one canvas rebuilds them all
+        size_t pixelCount = (size_t)animation->width * animation->height;
+        Uint32 *canvas = SDL_calloc(pixelCount, 4);
+        for (int i = 0; i < animation->textureCount; i++) {
+            unpackPixels(animation->packedTextures[i], canvas, pixelCount);
+            SDL_DestroyTexture(animation->uniqueTextures[i]);
+            animation->uniqueTextures[i] = createTextureFromPixels(renderer, animation->format, SDL_TEXTUREACCESS_STATIC, animation->width, animation->height, canvas);
+            failed |= !animation->uniqueTextures[i];
+            count++;
+        }
+        for (int frame = 0; frame < animation->frameCount; frame++) {
+            animation->textures[frame] = animation->uniqueTextures[animation->textureIndices[frame]];
+        }
+        SDL_free(canvas);
+    }
+
+    return failed ? -1 : count;
+}
+
+void initPlayhead(AnimationPlayhead *playhead, AnimatedImage *animation, int firstFrame, int frameCount) {
+    playhead->animation = animation;
+    playhead->firstFrame = firstFrame;
+    playhead->frameCount = frameCount;
+    resetAnimation(playhead);
+}
+
+void setAnimationFrame(AnimationPlayhead *playhead, int frame) {
+    playhead->currentFrame = frame;
+    playhead->currentDelayLeft = playhead->animation->delays[frame];
+}
+
+void resetAnimation(AnimationPlayhead *playhead) {
+    setAnimationFrame(playhead, playhead->firstFrame);
+}
+
+int updateAnimation(AnimationPlayhead *playhead, int delta) {
+    int lastFrame = playhead->currentFrame;
+    playhead->currentDelayLeft -= delta;
+    if (playhead->currentDelayLeft <= 0) {
+        int frame = playhead->currentFrame + 1;
+        if (frame == playhead->firstFrame + playhead->frameCount) {
+            frame = playhead->firstFrame;
+        }
+        playhead->currentFrame = frame;
+        playhead->currentDelayLeft += playhead->animation->delays[frame];
+    }
+    return playhead->currentFrame - lastFrame;
 }
 
-int updateAnimation(AnimatedImage *animation, int delta) {
-    int lastFrame = animation->currentFrame;
-    animation->currentDelayLeft -= delta;
-    if (animation->currentDelayLeft <= 0) {
-        animation->currentFrame = (animation->currentFrame + 1) % animation->frameCount;
-        animation->currentDelayLeft += animation->delays[animation->currentFrame];
+// Update all playheads by the same time in one pass, for many sprites sharing a few animations
+void updateAnimations(AnimationPlayhead *playheads, int count, int delta) {
+    for (int i = 0; i < count; i++) {
+        updateAnimation(&playheads[i], delta);
     }
-    return animation->currentFrame - lastFrame;
 }
 
-int isAnimationEnded(AnimatedImage *animation, int delta) {
-    return animation->currentFrame == animation->frameCount - 1 && animation->currentDelayLeft <= delta;
+int isAnimationEnded(const AnimationPlayhead *playhead, int delta) {
+    return playhead->currentFrame == playhead->firstFrame + playhead->frameCount - 1 && playhead->currentDelayLeft <= delta;
 }
@@ -2,31 +2,85 @@
 #define APP_IMAGE_h
 
 #include <SDL2/SDL.h>
+#include "arena.h"
+#include "mask.h"
 
-typedef struct {
+typedef struct StaticImage StaticImage;
+struct StaticImage {
     int width;
     int height;
     SDL_Texture *texture;
-} StaticImage;
+    AlphaMask *mask; // Only for images loaded with loadMaskedImageWebp, for hit testing
+    Uint32 format;
+    Uint32 *packed; // Compact copy of the pixels, to recreate the texture after the render device is reset
+    StaticImage *next;
+};
 
-StaticImage *loadImageWebp(SDL_Renderer *renderer, const char *file);
+// The image structs are allocated from the arena, the free functions only destroy the textures
+StaticImage *loadImageWebp(SDL_Renderer *renderer, Arena *arena, const char *file);
+StaticImage *loadMaskedImageWebp(SDL_Renderer *renderer, Arena *arena, const char *file);
 void freeImage(StaticImage *image);
 
-typedef struct {
+// Frames of an animation, shared by any number of playheads
+// Loading a file that is already loaded returns the same animation, every load or retain is paired with a freeAnimation
+typedef struct AnimatedImage AnimatedImage;
+struct AnimatedImage {
     int width;
     int height;
     int frameCount;
     int *delays;
-    SDL_Texture **textures;
-    int currentFrame;
+    SDL_Texture **textures; // Identical frames share the same texture
+    int *textureIndices;    // Index of every frame's texture in uniqueTextures
+    int textureCount;
+    SDL_Texture **uniqueTextures;
+    Uint32 format;
+    Uint32 **packedTextures; // Compact copy of every unique texture, each packed against the one before it
+    SDL_Renderer *renderer;
+    char *file;
+    int refCount;
+    AnimatedImage *next;
+};
+
+// Playback position in a range of frames of an animation, cheap enough to have one per sprite
+// A playhead doesn't hold a reference, the animation must outlive it
+typedef struct {
+    AnimatedImage *animation;
+    int firstFrame;
+    int frameCount;
+    int currentFrame; // Index into all frames of the animation, not relative to the first frame
     int currentDelayLeft;
-} AnimatedImage;
+} AnimationPlayhead;
 
 AnimatedImage *loadAnimationWebp(SDL_Renderer *renderer, const char *file);
-void setAnimationFrame(AnimatedImage *animation, int frame);
-void resetAnimation(AnimatedImage *animation);
+void prefetchAnimationWebp(const char *file);
+AnimatedImage *retainAnimation(AnimatedImage *animation);
 void freeAnimation(AnimatedImage *animation);
-int updateAnimation(AnimatedImage *animation, int delta);
-int isAnimationEnded(AnimatedImage *animation, int delta);
+
+void initPlayhead(AnimationPlayhead *playhead, AnimatedImage *animation, int firstFrame, int frameCount);
+void setAnimationFrame(AnimationPlayhead *playhead, int frame);
+void resetAnimation(AnimationPlayhead *playhead);
+int updateAnimation(AnimationPlayhead *playhead, int delta);
+void updateAnimations(AnimationPlayhead *playheads, int count, int delta);
+int isAnimationEnded(const AnimationPlayhead *playhead, int delta);
+
+// Recreate the textures of every loaded image after the render device was reset, without decoding them again
+// Loading, freeing and recreating must all happen on the same thread
+int recreateTextures(SDL_Renderer *renderer);
+
+// The stages of loadAnimationWebp, for loading in steps
+typedef struct {
+    int width;
+    int height;
+    int frameCount;
+    Uint32 format;
+    int *delays;
+    Uint8 *pixels; // Full canvas of every frame, one after another
+} DecodedAnimation;
+
+void *readFile(const char *file, size_t *sizeOut);
+Uint32 getNativePixelFormat(SDL_Renderer *renderer);
+int decodeAnimationWebp(const void *buffer, size_t size, Uint32 format, DecodedAnimation *animation);
+void freeDecodedAnimation(DecodedAnimation *animation);
+AnimatedImage *uploadAnimation(SDL_Renderer *renderer, const DecodedAnimation *decoded, const char *file);
 
 #endif
@@ -1,33 +1,107 @@
+#include <SDL2/SDL_mixer.h>
+#include "audio.h"
 #include "image.h"
+#include "present.h"
+#include "probe.h"
 #include "scene.h"
+#include "simulation.h"
+#include "threadpool.h"
 
 #define VIDEO_WIDTH  240
 #define VIDEO_HEIGHT 180
 #define MAX_FPS      60
 
-int gameLoop(SDL_Window *window, SDL_Renderer *renderer, SDL_Texture *renderTarget, Scene *scene) {
+static Uint64 startCounter; // When the process started, cleared once the first frame is presented
+
+static double getElapsedMs(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void logStartupStage(const char *stage, Uint64 start) {
+    SDL_Log("Startup: %s took %.1f ms", stage, getElapsedMs(start));
+}
+
+static void reportFirstPresent(void) {
+    if (startCounter) {
+        logStartupStage("cold start to the first present", startCounter);
+        startCounter = 0;
+    }
+}
+
+// Runs on its own thread during startup, returns -1 if audio is unavailable
+static int startAudio(void *data) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (Mix_Init(MIX_INIT_OGG) != MIX_INIT_OGG) {
+        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't initialize SDL mixer: %s", Mix_GetError());
+        return -1;
+    }
+    // Music is decoded on its own thread and mixed in the audio callback
+    if (openAudio(22050) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't open audio: %s", Mix_GetError());
+        return -1;
+    }
+    logStartupStage("audio", start);
+    return 0;
+}
+
+// Open audio on a thread and decode the intro on the thread pool, returns the audio thread to wait for
+static SDL_Thread *startAudioAndIntro(void) {
+    prefetchIntroScene();
+    SDL_Thread *audioThread = SDL_CreateThread(startAudio, "startup-audio", NULL);
+    if (!audioThread && startAudio(NULL) < 0) {
+        g_enableAudio = 0;
+    }
+    return audioThread;
+}
+
+// A render targets reset loses what was drawn on the target textures, a device reset loses every texture
+static void recoverRenderer(SDL_Renderer *renderer, SDL_Texture **renderTarget, Scene *scene, int isDeviceReset) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    int textureCount = 0;
+    if (isDeviceReset) {
+        textureCount = recreateTextures(renderer);
+        SDL_DestroyTexture(*renderTarget);
+        *renderTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, VIDEO_WIDTH, VIDEO_HEIGHT);
+        if (textureCount < 0 || !*renderTarget) {
+            SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't recreate all textures after the render device reset: %s", SDL_GetError());
+        }
+    }
+    if (scene->renderReset) {
+        scene->renderReset(scene);
+    }
+    SDL_Log("Recovered from render %s reset in %.2f ms, %d textures recreated", isDeviceReset ? "device" : "targets",
+            (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency(), SDL_max(textureCount, 0));
+}
+
+int gameLoop(SDL_Window *window, SDL_Renderer *renderer, SDL_Texture **renderTarget, Presenter *presenter, Scene *scene) {
     SDL_Event event;
     int windowWidth, windowHeight;
+    int isHandCursor = 0;
     Uint64 lastTicks = SDL_GetTicks64();
     SDL_GetWindowSize(window, &windowWidth, &windowHeight);
 
+    // The scene is updated on the simulation thread, this thread only handles events and draws the snapshots
+    Simulation *simulation = startSimulation(scene);
+    if (!simulation) {
+        scene->free(scene);
+        return -1;
+    }
+
     for (;;) {
         while (SDL_PollEvent(&event)) {
             switch (event.type) {
             case SDL_MOUSEBUTTONDOWN:
-                if (scene->mouseDown && event.button.button == SDL_BUTTON_LEFT) {
-                    scene->mouseDown(scene, event.button.x * VIDEO_WIDTH / windowWidth, event.button.y * VIDEO_HEIGHT / windowHeight);
+                if (event.button.button == SDL_BUTTON_LEFT) {
+                    postSimulationInput(simulation, SIMULATION_MOUSE_DOWN, event.button.x * VIDEO_WIDTH / windowWidth, event.button.y * VIDEO_HEIGHT / windowHeight);
                 }
                 break;
             case SDL_MOUSEBUTTONUP:
-                if (scene->mouseUp && event.button.button == SDL_BUTTON_LEFT) {
-                    scene->mouseUp(scene, event.button.x * VIDEO_WIDTH / windowWidth, event.button.y * VIDEO_HEIGHT / windowHeight);
+                if (event.button.button == SDL_BUTTON_LEFT) {
+                    postSimulationInput(simulation, SIMULATION_MOUSE_UP, event.button.x * VIDEO_WIDTH / windowWidth, event.button.y * VIDEO_HEIGHT / windowHeight);
                 }
                 break;
             case SDL_MOUSEMOTION:
-                if (scene->mouseMove) {
-                    scene->mouseMove(scene, event.button.x * VIDEO_WIDTH / windowWidth, event.button.y * VIDEO_HEIGHT / windowHeight);
-                }
+                postSimulationInput(simulation, SIMULATION_MOUSE_MOVE, event.button.x * VIDEO_WIDTH / windowWidth, event.button.y * VIDEO_HEIGHT / windowHeight);
                 break;
             case SDL_WINDOWEVENT:
                 if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
@@ -35,12 +109,36 @@ int gameLoop(SDL_Window *window, SDL_Renderer *renderer, SDL_Texture *renderTarg
                     windowHeight = event.window.data2;
                 }
                 break;
+            case SDL_RENDER_TARGETS_RESET:
+            case SDL_RENDER_DEVICE_RESET:
+                // The textures are only used on this thread, the simulation can keep running
+                recoverRenderer(renderer, renderTarget, scene, event.type == SDL_RENDER_DEVICE_RESET);
+                break;
             case SDL_QUIT:
+                stopSimulation(simulation);
                 scene->free(scene);
                 return 0;
             }
         }
 
+        if (isSimulationFinished(simulation)) {
+            // If the update function returned a function that creates a new scene, switch scene
+            Scene *(*createNextScene)(SDL_Renderer *) = stopSimulation(simulation);
+            scene->free(scene);
+            scene = createNextScene(renderer);
+            if (!scene) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize next scene");
+                return -1;
+            }
+            scene->startTime = SDL_GetTicks64();
+            simulation = startSimulation(scene);
+            if (!simulation) {
+                scene->free(scene);
+                return -1;
+            }
+            continue;
+        }
+
         Uint64 currentTicks = SDL_GetTicks64();
         int delta = currentTicks - lastTicks;
         if (delta < 1000 / MAX_FPS) {
@@ -50,43 +148,65 @@ int gameLoop(SDL_Window *window, SDL_Renderer *renderer, SDL_Texture *renderTarg
         }
         lastTicks = currentTicks;
 
-        Scene *(*createNextScene)(SDL_Renderer *) = scene->update(scene, delta, currentTicks);
-        if (createNextScene) {
-            // If the update function returns a function that creates a new scene, switch scene
-            scene->free(scene);
-            scene = createNextScene(renderer);
-            if (!scene) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize next scene");
-                return -1;
-            }
-            scene->startTime = currentTicks;
+        const SceneSnapshot *snapshot = acquireSimulationSnapshot(simulation);
+        if (!snapshot) {
+            // The simulation thread hasn't published anything yet
+            continue;
+        }
+
+        if (isHandCursor != snapshot->isHandCursor) {
+            isHandCursor = snapshot->isHandCursor;
+            SDL_SetCursor(isHandCursor ? g_handCursor : SDL_GetDefaultCursor());
+        }
+
+        if (snapshot->isFullScreen && !presenter) {
+            // Only one texture to draw, draw it on the window directly
+            SDL_SetRenderTarget(renderer, NULL);
+            drawFullScreenSnapshot(renderer, snapshot);
+            SDL_RenderPresent(renderer);
+            reportFirstPresent();
+            continue;
         }
-        else {
-            // Draw the scene on the target texture
-            SDL_SetRenderTarget(renderer, renderTarget);
-            scene->draw(renderer, scene);
+
+        // Draw the scene on the target texture
+        SDL_SetRenderTarget(renderer, *renderTarget);
+        scene->draw(renderer, scene, snapshot);
+        if (!presenter || presentUpscaled(presenter) < 0) {
             // Draw the target texture on the window
             SDL_SetRenderTarget(renderer, NULL);
-            SDL_RenderCopy(renderer, renderTarget, NULL, NULL);
+            SDL_RenderCopy(renderer, *renderTarget, NULL, NULL);
             SDL_RenderPresent(renderer);
         }
+        reportFirstPresent();
     }
 }
 
 int main(int argc, char *argv[]) {
     g_enableAudio = 1;
+    startCounter = SDL_GetPerformanceCounter();
 
     // Initialize SDL
+    // Both subsystems are initialized here, SDL doesn't support initializing subsystems on several threads at once
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't initialize SDL: %s", SDL_GetError());
         return -1;
     }
+    logStartupStage("SDL", startCounter);
 
-    // Initialize SDL mixer. If failed, disable audio and continue
-    if (Mix_Init(MIX_INIT_OGG) != MIX_INIT_OGG) {
-        g_enableAudio = 0;
-        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't initialize SDL mixer: %s", Mix_GetError());
-    }
+    // Worker threads for decoding animations
+    initThreadPool();
+
+    Options options;
+    parseOptions(argc, argv, &options);
+
+    // Audio and the intro don't depend on the window or on each other, start them while the window comes up
+    // Measuring the render drivers would also time the decoding, so when that happens they start after it
+    // --serial-startup does every step on this thread, to compare the cold start against the overlapped one
+    int renderDriver;
+    int needsProbe = chooseRenderDriver(&options, &renderDriver);
+    SDL_Thread *audioThread = needsProbe || options.serialStartup ? NULL : startAudioAndIntro();
+
+    Uint64 stageStart = SDL_GetPerformanceCounter();
 
     // Create the window and renderer
     // SDL_WINDOW_RESIZABLE - the window is resizable
@@ -96,9 +216,27 @@ int main(int argc, char *argv[]) {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create window: %s", SDL_GetError());
         return -1;
     }
+    logStartupStage("window", stageStart);
+    stageStart = SDL_GetPerformanceCounter();
 
+    // Use the renderer that was measured to be the fastest on this machine
     // SDL_RENDERER_TARGETTEXTURE - allow rendering to a texture
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    SDL_Renderer *renderer = NULL;
+    if (needsProbe) {
+        renderDriver = probeRenderDrivers(window, VIDEO_WIDTH, VIDEO_HEIGHT);
+        if (!options.serialStartup) {
+            audioThread = startAudioAndIntro();
+        }
+    }
+    if (renderDriver >= 0) {
+        renderer = SDL_CreateRenderer(window, renderDriver, SDL_RENDERER_TARGETTEXTURE);
+        if (!renderer) {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create the chosen renderer: %s", SDL_GetError());
+        }
+    }
+    if (!renderer) {
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    }
     if (!renderer) {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Couldn't create accelerated renderer: %s", SDL_GetError());
 
@@ -118,27 +256,49 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    if (g_enableAudio && Mix_OpenAudio(22050, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 4096) < 0) {
-        g_enableAudio = 0;
-        SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't open audio: %s", Mix_GetError());
-    }
+    // The software renderer stretches the render target on one thread, upscale it on all cores instead
+    Presenter *presenter = createPresenter(window, renderer, VIDEO_WIDTH, VIDEO_HEIGHT);
+    logStartupStage("renderer", stageStart);
 
     // Store the cursor as global variable
     g_handCursor = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_HAND);
 
+    // The intro starts its music, so audio has to be ready first
+    stageStart = SDL_GetPerformanceCounter();
+    if (options.serialStartup) {
+        if (startAudio(NULL) < 0) {
+            g_enableAudio = 0;
+        }
+    }
+    else if (audioThread) {
+        int audioStatus;
+        SDL_WaitThread(audioThread, &audioStatus);
+        if (audioStatus < 0) {
+            g_enableAudio = 0;
+        }
+    }
+    logStartupStage("waiting for audio", stageStart);
+
+    // Waits for the intro to finish decoding, then only uploads it
+    stageStart = SDL_GetPerformanceCounter();
     Scene *scene = createIntroScene(renderer);
     if (!scene) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize the first scene");
         return -1;
     }
+    logStartupStage("intro scene", stageStart);
 
-    int status = gameLoop(window, renderer, renderTarget, scene);
+    int status = gameLoop(window, renderer, &renderTarget, presenter, scene);
 
     // Release everything
     if (g_enableAudio) {
-        Mix_CloseAudio();
+        closeAudio();
     }
+    quitThreadPool();
     SDL_FreeCursor(g_handCursor);
+    if (presenter) {
+        freePresenter(presenter);
+    }
     SDL_DestroyTexture(renderTarget);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
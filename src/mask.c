@@ -0,0 +1,67 @@
+#include "mask.h"
+
+#define ALPHA_THRESHOLD 128 // Mostly transparent antialiased edges don't count
+
+// Build the mask from 32-bit pixels with the alpha in the last byte, as RGBA32 and BGRA32 both have it
+AlphaMask *createAlphaMask(Arena *arena, const Uint8 *pixels, int pitch, int width, int height) {
+    AlphaMask *mask = arenaAlloc(arena, sizeof(AlphaMask));
+    mask->width = width;
+    mask->height = height;
+    mask->wordsPerRow = (width + 31) / 32;
+    mask->bits = arenaAlloc(arena, sizeof(Uint32) * mask->wordsPerRow * height);
+
+    for (int y = 0; y < height; y++) {
+        const Uint8 *alpha = pixels + y * pitch + 3;
+        Uint32 *row = mask->bits + y * mask->wordsPerRow;
+        for (int x = 0; x < width; x++) {
+            if (alpha[x * 4] >= ALPHA_THRESHOLD) {
+                row[x >> 5] |= 1u << (x & 31);
+            }
+        }
+    }
+    return mask;
+}
+
+int isMaskPointSet(const AlphaMask *mask, int x, int y) {
+    if (x < 0 || y < 0 || x >= mask->width || y >= mask->height) {
+        return 0;
+    }
+    return (mask->bits[y * mask->wordsPerRow + (x >> 5)] >> (x & 31)) & 1;
+}
+
+// Whether any bit is set inside the rect, testing 32 pixels at a time
+int maskOverlapsRect(const AlphaMask *mask, const SDL_Rect *rect) {
+    SDL_Rect bounds = { 0, 0, mask->width, mask->height };
+    SDL_Rect area;
+    if (!SDL_IntersectRect(rect, &bounds, &area)) {
+        return 0;
+    }
+
+    int lastX = area.x + area.w - 1;
+    int firstWord = area.x >> 5;
+    int lastWord = lastX >> 5;
+    Uint32 firstBits = 0xffffffffu << (area.x & 31);
+    Uint32 lastBits = 0xffffffffu >> (31 - (lastX & 31));
+    if (firstWord == lastWord) {
+        firstBits &= lastBits;
+    }
+
+    for (int y = area.y; y < area.y + area.h; y++) {
+        const Uint32 *row = mask->bits + y * mask->wordsPerRow;
+        if (row[firstWord] & firstBits) {
+            return 1;
+        }
+        if (firstWord == lastWord) {
+            continue;
+        }
+        for (int i = firstWord + 1; i < lastWord; i++) {
+            if (row[i]) {
+                return 1;
+            }
+        }
+        if (row[lastWord] & lastBits) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef APP_MASK_h
+#define APP_MASK_h
+
+#include <SDL2/SDL.h>
+#include "arena.h"
+
+// One bit per pixel, set where the pixel is opaque enough to be hit
+// Bit x % 32 of word x / 32 in every row, rows are padded to whole words
+typedef struct {
+    int width;
+    int height;
+    int wordsPerRow;
+    Uint32 *bits;
+} AlphaMask;
+
+AlphaMask *createAlphaMask(Arena *arena, const Uint8 *pixels, int pitch, int width, int height);
+int isMaskPointSet(const AlphaMask *mask, int x, int y);
+int maskOverlapsRect(const AlphaMask *mask, const SDL_Rect *rect);
+
+#endif
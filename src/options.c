@@ -0,0 +1,19 @@
+#include "options.h"
+
+void parseOptions(int argc, char *argv[], Options *options) {
+    SDL_zerop(options);
+    for (int i = 1; i < argc; i++) {
+        if (SDL_strncmp(argv[i], "--renderer=", 11) == 0) {
+            // The first one wins
+            if (!options->renderer) {
+                options->renderer = argv[i] + 11;
+            }
+        }
+        else if (SDL_strcmp(argv[i], "--probe") == 0) {
+            options->probe = 1;
+        }
+        else if (SDL_strcmp(argv[i], "--serial-startup") == 0) {
+            options->serialStartup = 1;
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef APP_OPTIONS_h
+#define APP_OPTIONS_h
+
+#include <SDL2/SDL.h>
+
+// Command line options, unknown arguments are ignored
+typedef struct {
+    const char *renderer; // --renderer=<name>, NULL to use the cached or measured choice
+    int probe;            // --probe, measure the render drivers again even if a choice is cached
+    int serialStartup;    // --serial-startup, open audio and decode the intro one after the other on the main thread
+} Options;
+
+void parseOptions(int argc, char *argv[], Options *options);
+
+#endif
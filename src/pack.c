@@ -0,0 +1,45 @@
+#include "pack.h"
+
+// Every token is a header word with the number of unchanged words in the high half and the number of changed
+// words in the low half, followed by the changed words XORed with the base
+#define MAX_RUN 0xffff
+
+// Every token covers at least one word, and every word is stored at most once
+size_t getPackBound(size_t count) {
+    return count * 2 + 1;
+}
+
+// The base is the image the pixels will be unpacked over, or NULL for an empty image
+size_t packPixels(const Uint32 *pixels, const Uint32 *base, size_t count, Uint32 *packed) {
+    size_t size = 0;
+    size_t i = 0;
+    while (i < count) {
+        size_t run = 0;
+        while (i < count && run < MAX_RUN && pixels[i] == (base ? base[i] : 0)) {
+            run++;
+            i++;
+        }
+
+        Uint32 *header = &packed[size++];
+        size_t literals = 0;
+        while (i < count && literals < MAX_RUN && pixels[i] != (base ? base[i] : 0)) {
+            packed[size++] = pixels[i] ^ (base ? base[i] : 0);
+            literals++;
+            i++;
+        }
+        *header = (Uint32)run << 16 | (Uint32)literals;
+    }
+    return size;
+}
+
+// The pixels must hold the base image, or zeros if there was no base
+void unpackPixels(const Uint32 *packed, Uint32 *pixels, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+        Uint32 header = *packed++;
+        i += header >> 16;
+        for (Uint32 literals = header & MAX_RUN; literals > 0; literals--) {
+            pixels[i++] ^= *packed++;
+        }
+    }
+}
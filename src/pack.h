@@ -0,0 +1,12 @@
+#ifndef APP_PACK_h
+#define APP_PACK_h
+
+#include <SDL2/SDL.h>
+
+// Compact copies of pixels, stored as the XOR against a base image with the runs of unchanged words removed
+// Sizes are in 32-bit words
+size_t getPackBound(size_t count);
+size_t packPixels(const Uint32 *pixels, const Uint32 *base, size_t count, Uint32 *packed);
+void unpackPixels(const Uint32 *packed, Uint32 *pixels, size_t count);
+
+#endif
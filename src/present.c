@@ -0,0 +1,132 @@
+#include "present.h"
+#include "threadpool.h"
+
+#define BANDS_PER_THREAD 4
+
+struct Presenter {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    int width;
+    int height;
+    Uint32 *source;
+    int *sourceX; // Source column of every window column
+    int windowWidth;
+};
+
+typedef struct {
+    const Uint32 *source;
+    int sourceWidth;
+    int sourceHeight;
+    const int *sourceX;
+    Uint8 *pixels;
+    int pitch;
+    int width;
+    int height;
+    int bandHeight;
+} UpscaleJob;
+
+static void upscaleBand(int band, void *data) {
+    UpscaleJob *job = data;
+    int startY = band * job->bandHeight;
+    int endY = SDL_min(startY + job->bandHeight, job->height);
+    int scaleX = job->width % job->sourceWidth == 0 ? job->width / job->sourceWidth : 0;
+    int lastSourceY = -1;
+
+    for (int y = startY; y < endY; y++) {
+        Uint32 *dst = (Uint32 *)(job->pixels + y * job->pitch);
+        int sourceY = y * job->sourceHeight / job->height;
+        if (sourceY == lastSourceY) {
+            // Same source row as the line above, which is always in the same band
+            SDL_memcpy(dst, job->pixels + (y - 1) * job->pitch, job->width * 4);
+            continue;
+        }
+        lastSourceY = sourceY;
+
+        const Uint32 *src = job->source + sourceY * job->sourceWidth;
+        if (scaleX) {
+            // Exact integer scale, repeat every pixel without looking up the columns
+            for (int x = 0; x < job->sourceWidth; x++) {
+                Uint32 pixel = src[x];
+                for (int i = 0; i < scaleX; i++) {
+                    *dst++ = pixel;
+                }
+            }
+        }
+        else {
+            for (int x = 0; x < job->width; x++) {
+                dst[x] = src[job->sourceX[x]];
+            }
+        }
+    }
+}
+
+// Only the software renderer stretches on the CPU, other renderers are faster with SDL_RenderCopy
+Presenter *createPresenter(SDL_Window *window, SDL_Renderer *renderer, int width, int height) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) < 0 || !(info.flags & SDL_RENDERER_SOFTWARE)) {
+        return NULL;
+    }
+
+    Presenter *presenter = SDL_malloc(sizeof(Presenter));
+    SDL_zerop(presenter);
+    presenter->window = window;
+    presenter->renderer = renderer;
+    presenter->width = width;
+    presenter->height = height;
+    presenter->source = SDL_malloc(width * height * 4);
+    return presenter;
+}
+
+// Upscale the current render target straight into the window surface, the render target must still be set
+// Returns -1 only if nothing was presented, so the caller can fall back to SDL_RenderCopy
+int presentUpscaled(Presenter *presenter) {
+    SDL_Surface *surface = SDL_GetWindowSurface(presenter->window);
+    if (!surface || surface->format->BytesPerPixel != 4 || surface->w <= 0 || surface->h <= 0) {
+        return -1;
+    }
+    // Read back in the window format, so the scaling is a plain copy of pixels
+    if (SDL_RenderReadPixels(presenter->renderer, NULL, surface->format->format, presenter->source, presenter->width * 4) < 0) {
+        return -1;
+    }
+
+    if (presenter->windowWidth != surface->w) {
+        presenter->windowWidth = surface->w;
+        SDL_free(presenter->sourceX);
+        presenter->sourceX = SDL_malloc(surface->w * sizeof(int));
+        for (int x = 0; x < surface->w; x++) {
+            presenter->sourceX[x] = x * presenter->width / surface->w;
+        }
+    }
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0) {
+        return -1;
+    }
+
+    UpscaleJob job;
+    job.source = presenter->source;
+    job.sourceWidth = presenter->width;
+    job.sourceHeight = presenter->height;
+    job.sourceX = presenter->sourceX;
+    job.pixels = surface->pixels;
+    job.pitch = surface->pitch;
+    job.width = surface->w;
+    job.height = surface->h;
+    int bandCount = SDL_min(getThreadPoolSize() * BANDS_PER_THREAD, surface->h);
+    job.bandHeight = (surface->h + bandCount - 1) / bandCount;
+    parallelFor((surface->h + job.bandHeight - 1) / job.bandHeight, upscaleBand, &job);
+
+    if (SDL_MUSTLOCK(surface)) {
+        SDL_UnlockSurface(surface);
+    }
+    // The surface may already be on screen, falling back now would present the frame a second time
+    if (SDL_UpdateWindowSurface(presenter->window) < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't update window surface: %s", SDL_GetError());
+    }
+    return 0;
+}
+
+void freePresenter(Presenter *presenter) {
+    SDL_free(presenter->source);
+    SDL_free(presenter->sourceX);
+    SDL_free(presenter);
+}
@@ -0,0 +1,12 @@
+#ifndef APP_PRESENT_h
+#define APP_PRESENT_h
+
+#include <SDL2/SDL.h>
+
+typedef struct Presenter Presenter;
+
+Presenter *createPresenter(SDL_Window *window, SDL_Renderer *renderer, int width, int height);
+int presentUpscaled(Presenter *presenter);
+void freePresenter(Presenter *presenter);
+
+#endif
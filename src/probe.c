@@ -0,0 +1,208 @@
+#include "probe.h"
+#include "present.h"
+#include "scene.h"
+
+#define PROBE_SETTLE_TIME   6000 // Game time to run before measuring, the first ingredient only appears after 1.5 s
+#define PROBE_WARMUP_FRAMES 10
+#define PROBE_FRAMES        120
+#define PROBE_FRAME_DELTA   16
+#define PROBE_MAX_JITTER    3 // The slowest 5% of the frames may take at most this many times the median
+#define CONFIG_FILE         "renderer.txt"
+
+static int compareFrameTimes(const void *a, const void *b) {
+    Uint64 x = *(const Uint64 *)a;
+    Uint64 y = *(const Uint64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int findRenderDriver(const char *name) {
+    for (int i = 0; i < SDL_GetNumRenderDrivers(); i++) {
+        SDL_RendererInfo info;
+        if (SDL_GetRenderDriverInfo(i, &info) == 0 && SDL_strcasecmp(info.name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static char *getConfigPath(void) {
+    char *prefPath = SDL_GetPrefPath("pony-the-cook", "Cook");
+    if (!prefPath) {
+        return NULL;
+    }
+    size_t size = SDL_strlen(prefPath) + sizeof(CONFIG_FILE);
+    char *path = SDL_malloc(size);
+    SDL_snprintf(path, size, "%s%s", prefPath, CONFIG_FILE);
+    SDL_free(prefPath);
+    return path;
+}
+
+static int loadCachedRenderDriver(void) {
+    char *path = getConfigPath();
+    if (!path) {
+        return -1;
+    }
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    SDL_free(path);
+    if (!file) {
+        return -1;
+    }
+
+    char name[64];
+    size_t length = SDL_RWread(file, name, 1, sizeof(name) - 1);
+    SDL_RWclose(file);
+    while (length > 0 && (name[length - 1] == '\n' || name[length - 1] == '\r')) {
+        length--;
+    }
+    name[length] = '\0';
+    return findRenderDriver(name);
+}
+
+static void saveCachedRenderDriver(const char *name) {
+    char *path = getConfigPath();
+    if (!path) {
+        return;
+    }
+    SDL_RWops *file = SDL_RWFromFile(path, "wb");
+    if (file) {
+        SDL_RWwrite(file, name, 1, SDL_strlen(name));
+        SDL_RWwrite(file, "\n", 1, 1);
+        SDL_RWclose(file);
+    }
+    else {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Couldn't save %s: %s", path, SDL_GetError());
+    }
+    SDL_free(path);
+}
+
+// Run the game scene for a while and return the median frame time in performance counter ticks, or 0 on failure
+// Every driver gets its own hidden window the size of the game window, a software renderer leaves a surface on the window it used
+static Uint64 probeRenderDriver(SDL_Window *gameWindow, int driver, int width, int height, Uint64 *slowFrameTime) {
+    int windowWidth, windowHeight;
+    SDL_GetWindowSize(gameWindow, &windowWidth, &windowHeight);
+    SDL_Window *window = SDL_CreateWindow("Cook", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, windowWidth, windowHeight, SDL_WINDOW_HIDDEN | SDL_WINDOW_ALLOW_HIGHDPI);
+    if (!window) {
+        return 0;
+    }
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, driver, SDL_RENDERER_TARGETTEXTURE);
+    if (!renderer) {
+        SDL_DestroyWindow(window);
+        return 0;
+    }
+    SDL_Texture *renderTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    Scene *scene = renderTarget ? createGameScene(renderer) : NULL;
+    if (!scene) {
+        if (renderTarget) {
+            SDL_DestroyTexture(renderTarget);
+        }
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        return 0;
+    }
+    // Present the same way as the game loop, the software renderer upscales on the CPU
+    Presenter *presenter = createPresenter(window, renderer, width, height);
+
+    // Let ingredients come in so the eyes follow them, the empty table at the start is cheaper than the real game
+    Uint64 time = 0;
+    while (time < PROBE_SETTLE_TIME) {
+        time += PROBE_FRAME_DELTA;
+        scene->update(scene, PROBE_FRAME_DELTA, time);
+    }
+
+    SceneSnapshot *snapshot = SDL_malloc(scene->snapshotSize);
+    Uint64 frameTimes[PROBE_FRAMES];
+    for (int i = 0; i < PROBE_WARMUP_FRAMES + PROBE_FRAMES; i++) {
+        time += PROBE_FRAME_DELTA;
+        scene->update(scene, PROBE_FRAME_DELTA, time);
+        scene->snapshot(scene, snapshot);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        SDL_SetRenderTarget(renderer, renderTarget);
+        scene->draw(renderer, scene, snapshot);
+        // Reading the frame back waits until the renderer has actually finished it
+        if (!presenter || presentUpscaled(presenter) < 0) {
+            SDL_SetRenderTarget(renderer, NULL);
+            SDL_RenderCopy(renderer, renderTarget, NULL, NULL);
+            Uint32 pixel;
+            SDL_Rect pixelRect = { 0, 0, 1, 1 };
+            SDL_RenderReadPixels(renderer, &pixelRect, SDL_PIXELFORMAT_RGBA8888, &pixel, 4);
+        }
+        if (i >= PROBE_WARMUP_FRAMES) {
+            frameTimes[i - PROBE_WARMUP_FRAMES] = SDL_GetPerformanceCounter() - start;
+        }
+    }
+
+    SDL_free(snapshot);
+    if (presenter) {
+        freePresenter(presenter);
+    }
+    scene->free(scene);
+    SDL_DestroyTexture(renderTarget);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+
+    SDL_qsort(frameTimes, PROBE_FRAMES, sizeof(Uint64), compareFrameTimes);
+    *slowFrameTime = frameTimes[PROBE_FRAMES * 95 / 100];
+    return SDL_max(frameTimes[PROBE_FRAMES / 2], 1);
+}
+
+// Measure every render driver and cache the fastest stable one, returns its index or -1 if none works
+// The window only gives the size to measure at, each driver draws on a hidden window of its own
+int probeRenderDrivers(SDL_Window *window, int width, int height) {
+    // Don't play the game scene music while probing
+    int enableAudio = g_enableAudio;
+    g_enableAudio = 0;
+
+    int bestDriver = -1;
+    int bestIsStable = 0;
+    Uint64 bestFrameTime = 0;
+    for (int i = 0; i < SDL_GetNumRenderDrivers(); i++) {
+        SDL_RendererInfo info;
+        if (SDL_GetRenderDriverInfo(i, &info) < 0) {
+            continue;
+        }
+
+        Uint64 slowFrameTime;
+        Uint64 frameTime = probeRenderDriver(window, i, width, height, &slowFrameTime);
+        if (!frameTime) {
+            SDL_Log("Renderer %s: unavailable", info.name);
+            continue;
+        }
+
+        int isStable = slowFrameTime <= frameTime * PROBE_MAX_JITTER;
+        SDL_Log("Renderer %s: median %.3f ms, 95th percentile %.3f ms%s", info.name,
+                frameTime * 1000.0 / SDL_GetPerformanceFrequency(), slowFrameTime * 1000.0 / SDL_GetPerformanceFrequency(),
+                isStable ? "" : " (unstable)");
+
+        // A stable renderer always wins over an unstable one
+        if (bestDriver < 0 || isStable > bestIsStable || (isStable == bestIsStable && frameTime < bestFrameTime)) {
+            bestDriver = i;
+            bestIsStable = isStable;
+            bestFrameTime = frameTime;
+        }
+    }
+
+    g_enableAudio = enableAudio;
+
+    if (bestDriver >= 0) {
+        SDL_RendererInfo info;
+        SDL_GetRenderDriverInfo(bestDriver, &info);
+        SDL_Log("Using renderer %s", info.name);
+        saveCachedRenderDriver(info.name);
+    }
+    return bestDriver;
+}
+
+// Take the render driver forced with --renderer or cached by an earlier probe, the index is -1 to let SDL decide
+// Returns 1 if there is no choice yet and probeRenderDrivers has to measure the drivers
+int chooseRenderDriver(const Options *options, int *driver) {
+    if (options->renderer) {
+        *driver = findRenderDriver(options->renderer);
+        if (*driver < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Unknown renderer: %s", options->renderer);
+        }
+        return 0;
+    }
+    *driver = options->probe ? -1 : loadCachedRenderDriver();
+    return *driver < 0;
+}
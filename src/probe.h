@@ -0,0 +1,10 @@
+#ifndef APP_PROBE_h
+#define APP_PROBE_h
+
+#include <SDL2/SDL.h>
+#include "options.h"
+
+int chooseRenderDriver(const Options *options, int *driver);
+int probeRenderDrivers(SDL_Window *window, int width, int height);
+
+#endif
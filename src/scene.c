@@ -3,40 +3,66 @@
 int g_enableAudio;
 SDL_Cursor *g_handCursor;
 
-Mix_Music *loadAndPlayMusic(const char *file, int loops) {
-    Mix_Music *music = NULL;
+void playSceneMusic(const char *file, int loop) {
     if (g_enableAudio) {
-        music = Mix_LoadMUS(file);
-        if (music) {
-            Mix_PlayMusic(music, loops);
-        }
+        playMusic(file, loop);
     }
-    return music;
+}
+
+Scene *allocScene(const char *name) {
+    Arena *arena = createArena(name);
+    Scene *scene = arenaAlloc(arena, sizeof(Scene));
+    scene->arena = arena;
+    return scene;
 }
 
 void simpleFreeScene(Scene *scene) {
-    freeAnimation(scene->animation);
-    if (scene->music) {
-        Mix_FreeMusic(scene->music);
-    }
-    SDL_SetCursor(SDL_GetDefaultCursor());
-    SDL_free(scene);
+    freeAnimation(scene->playhead.animation);
+    freeArena(scene->arena);
+}
+
+void simpleSnapshotScene(Scene *scene, SceneSnapshot *snapshot) {
+    snapshot->animation = scene->playhead.animation;
+    snapshot->frame = scene->playhead.currentFrame;
+    snapshot->fading = scene->fadeOutStart != 0;
+    snapshot->alpha = scene->alpha;
+    snapshot->isHandCursor = scene->isHandCursor;
+    snapshot->isFullScreen = 1;
 }
 
-void simpleDrawScene(SDL_Renderer *renderer, Scene *scene) {
-    SDL_Texture *texture = scene->animation->textures[scene->animation->currentFrame];
+void simpleDrawScene(SDL_Renderer *renderer, Scene *scene, const SceneSnapshot *snapshot) {
+    SDL_Texture *texture = snapshot->animation->textures[snapshot->frame];
     SDL_RenderCopy(renderer, texture, NULL, NULL);
-    if (scene->fadeOutStart) {
+    if (snapshot->fading) {
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255 - scene->alpha);
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255 - snapshot->alpha);
         SDL_RenderFillRect(renderer, NULL);
     }
 }
 
+// Draw a full screen snapshot straight on the window without going through the render target
+// The fade out is done by drawing the frame translucent on a white background instead of filling over it
+void drawFullScreenSnapshot(SDL_Renderer *renderer, const SceneSnapshot *snapshot) {
+    SDL_Texture *texture = snapshot->animation->textures[snapshot->frame];
+    if (snapshot->fading) {
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        SDL_RenderClear(renderer);
+        SDL_SetTextureAlphaMod(texture, snapshot->alpha);
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        SDL_SetTextureAlphaMod(texture, 255);
+    }
+    else {
+        // The frame is opaque, skip blending
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+}
+
 void startFadeOut(Scene *scene, Uint64 time) {
     if (!scene->fadeOutStart) {
-        if (scene->music) {
-            Mix_FadeOutMusic(1000);
+        if (g_enableAudio) {
+            fadeOutMusic(1000);
         }
         scene->alpha = 255;
         scene->fadeOutStart = time;
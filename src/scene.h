@@ -1,23 +1,40 @@
 #ifndef APP_SCENE_h
 #define APP_SCENE_h
 
-#include <SDL2/SDL_mixer.h>
+#include "audio.h"
 #include "image.h"
 
 extern int g_enableAudio;
 extern SDL_Cursor *g_handCursor;
 
+// Immutable copy of the scene state that is needed to draw a frame
+// Scenes with more to draw extend this struct by putting it as the first member
+typedef struct {
+    AnimatedImage *animation;
+    int frame;
+    int fading;
+    int alpha;
+    int isHandCursor;
+    int isFullScreen; // The frame is a single opaque texture covering the screen, plus the fade out
+} SceneSnapshot;
+
 typedef struct Scene Scene;
 struct Scene {
-    AnimatedImage *animation;
-    Mix_Music *music;
+    Arena *arena; // Owns the scene and everything else allocated for it
+    AnimationPlayhead playhead;
     Uint64 startTime;
     Uint64 fadeOutStart;
     int alpha;
+    int isHandCursor;
 
+    // The update, snapshot and mouse functions run on the simulation thread
+    // The draw and free functions run on the main thread and only read the snapshot and the loaded images
+    size_t snapshotSize;
     Scene *(*(*update)(Scene *, int, Uint64))(SDL_Renderer *);
-    void (*draw)(SDL_Renderer *, Scene *);
+    void (*snapshot)(Scene *, SceneSnapshot *);
+    void (*draw)(SDL_Renderer *, Scene *, const SceneSnapshot *);
     void (*free)(Scene *);
+    void (*renderReset)(Scene *); // Optional, the textures the scene drew into have lost their content
 
     void (*mouseDown)(Scene *, int, int);
     void (*mouseMove)(Scene *, int, int);
@@ -26,13 +43,17 @@ struct Scene {
     void *params;
 };
 
-Mix_Music *loadAndPlayMusic(const char *file, int loops);
+void playSceneMusic(const char *file, int loop);
+Scene *allocScene(const char *name);
 void simpleFreeScene(Scene *scene);
-void simpleDrawScene(SDL_Renderer *renderer, Scene *scene);
+void simpleSnapshotScene(Scene *scene, SceneSnapshot *snapshot);
+void simpleDrawScene(SDL_Renderer *renderer, Scene *scene, const SceneSnapshot *snapshot);
+void drawFullScreenSnapshot(SDL_Renderer *renderer, const SceneSnapshot *snapshot);
 void startFadeOut(Scene *scene, Uint64 time);
 int processFadeOut(Scene *scene, Uint64 time);
 void clickSkipSceneHandler(Scene *scene, int x, int y);
 
+void prefetchIntroScene(void);
 Scene *createIntroScene(SDL_Renderer *renderer);
 Scene *createOutroScene(SDL_Renderer *renderer);
 Scene *createGameScene(SDL_Renderer *renderer);
@@ -1,39 +1,45 @@
 #include "scene.h"
 
 static Scene *(*updateGameIntroScene(Scene *scene, int delta, Uint64 time))(SDL_Renderer *) {
-    AnimatedImage *animation = scene->animation;
+    AnimationPlayhead *playhead = &scene->playhead;
     if (scene->fadeOutStart) {
         if (processFadeOut(scene, time)) {
             return createGameScene;
         }
     }
 
-    if (isAnimationEnded(animation, delta)) {
+    if (isAnimationEnded(playhead, delta)) {
         startFadeOut(scene, time);
     }
     else {
-        updateAnimation(animation, delta);
+        updateAnimation(playhead, delta);
     }
 
     return NULL;
 }
 
+// Decode the intro while the window and renderer are still being created
+void prefetchIntroScene(void) {
+    prefetchAnimationWebp("images/intro.webp");
+}
+
 Scene *createIntroScene(SDL_Renderer *renderer) {
-    Scene *scene = SDL_malloc(sizeof(Scene));
-    SDL_zerop(scene);
+    Scene *scene = allocScene("intro");
 
     AnimatedImage *animation = loadAnimationWebp(renderer, "images/intro.webp");
     if (!animation) {
+        freeArena(scene->arena);
         return NULL;
     }
 
-    scene->animation = animation;
-    scene->music = loadAndPlayMusic("sounds/intro.ogg", -1);
+    initPlayhead(&scene->playhead, animation, 0, animation->frameCount);
+    playSceneMusic("sounds/intro.ogg", 1);
     scene->update = updateGameIntroScene;
+    scene->snapshotSize = sizeof(SceneSnapshot);
+    scene->snapshot = simpleSnapshotScene;
     scene->draw = simpleDrawScene;
     scene->free = simpleFreeScene;
     scene->mouseDown = clickSkipSceneHandler;
-
-    SDL_SetCursor(g_handCursor);
+    scene->isHandCursor = 1;
     return scene;
 }
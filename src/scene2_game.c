@@ -6,6 +6,7 @@
 #define INGREDIENT_PLAIN 10 // How many ingredients are not rare
 #define INGREDIENT_QUEUE 4
 #define INGREDIENT_DELAY 1500
+#define EYE_BLITS        8 // Eye, pupil and two highlights for both eyes
 static const SDL_Rect dragTargetRect = { 50, 120, 160, 60 };
 
 typedef struct {
@@ -15,12 +16,14 @@ typedef struct {
     StaticImage *image;
 } UIButton;
 
-typedef struct {
+typedef struct GameSceneIngredient GameSceneIngredient;
+struct GameSceneIngredient {
     int type;
     int accurateX;
     int waveType;
     SDL_Rect rect;
-} GameSceneIngredient;
+    GameSceneIngredient *nextFree;
+};
 
 typedef struct {
     int finished;
@@ -37,13 +40,36 @@ typedef struct {
     AnimatedImage *actionAnimation;
     GameSceneIngredient *ingredients[INGREDIENT_QUEUE];
     GameSceneIngredient *draggingIngredient;
+    GameSceneIngredient *freeIngredients; // Removed items are reused, the arena never frees anything
+    Arena *arena;
 
-    int isHandCursor;
     int isAltIdleImage;
     SDL_Point cursor;
     SDL_Point dragOffset;
+
+    // Background, eyes and the animation frame drawn together, only redrawn when one of them changes
+    // Used only by the draw function on the main thread
+    SDL_Texture *layer;
+    SDL_Texture *layerFrame;
+    int layerHasEyes;
+    SDL_Point layerEyes[EYE_BLITS];
 } GameSceneParams;
 
+typedef struct {
+    int type;
+    SDL_Rect rect;
+} GameSceneSnapshotIngredient;
+
+typedef struct {
+    SceneSnapshot base;
+    int hasEyes;
+    SDL_Point eyes[EYE_BLITS];
+    int buttonHidden;
+    int buttonPressed;
+    int ingredientsCount;
+    GameSceneSnapshotIngredient ingredients[INGREDIENT_QUEUE];
+} GameSceneSnapshot;
+
 static void createUIButton(UIButton *button, StaticImage *image, int x, int y) {
     button->image = image;
     button->rect.x = x;
@@ -52,11 +78,22 @@ static void createUIButton(UIButton *button, StaticImage *image, int x, int y) {
     button->rect.h = image->height;
 }
 
-static void drawUIButton(SDL_Renderer *renderer, UIButton *button) {
-    SDL_Rect srcRect = { button->pressed ? button->rect.w : 0, 0, button->rect.w, button->rect.h };
+// Hit test on the opaque pixels of the normal half of the button image
+static int isPointOnUIButton(const UIButton *button, const SDL_Point *point) {
+    return SDL_PointInRect(point, &button->rect) &&
+           isMaskPointSet(button->image->mask, point->x - button->rect.x, point->y - button->rect.y);
+}
+
+static void drawUIButton(SDL_Renderer *renderer, UIButton *button, int pressed) {
+    SDL_Rect srcRect = { pressed ? button->rect.w : 0, 0, button->rect.w, button->rect.h };
     SDL_RenderCopy(renderer, button->image->texture, &srcRect, &button->rect);
 }
 
+// Play only the first half of the idle frames, the second half is for the beat animation
+static void initIdlePlayhead(AnimationPlayhead *playhead, AnimatedImage *idleAnimation) {
+    initPlayhead(playhead, idleAnimation, 0, idleAnimation->frameCount / 2);
+}
+
 static void generateTypesQueue(int *queue, int count) {
     // initialize the array
     for (int i = 0; i < count; i++) {
@@ -72,8 +109,14 @@ static void generateTypesQueue(int *queue, int count) {
 }
 
 static GameSceneIngredient *generateGameSceneIngredient(GameSceneParams *params) {
-    GameSceneIngredient *item = SDL_malloc(sizeof(GameSceneIngredient));
-    SDL_zerop(item);
+    GameSceneIngredient *item = params->freeIngredients;
+    if (item) {
+        params->freeIngredients = item->nextFree;
+        SDL_zerop(item);
+    }
+    else {
+        item = arenaAlloc(params->arena, sizeof(GameSceneIngredient));
+    }
     item->waveType = params->ingredientId % 2 == 0 ? 1 : -1;
     item->accurateX = INGREDIENT_MAX_X * 16;
     item->rect.x = INGREDIENT_MAX_X;
@@ -104,41 +147,98 @@ static GameSceneIngredient *generateGameSceneIngredient(GameSceneParams *params)
 }
 
 static void unsetGameSceneIngredient(GameSceneParams *params, int index) {
-    if (params->ingredients[index]) {
-        SDL_free(params->ingredients[index]);
+    GameSceneIngredient *item = params->ingredients[index];
+    if (item) {
+        item->nextFree = params->freeIngredients;
+        params->freeIngredients = item;
         params->ingredients[index] = NULL;
     }
 }
 
+// Hit test on the opaque pixels of the ingredient's cell in the sheet
+static int isPointOnIngredient(const GameSceneParams *params, const GameSceneIngredient *item, const SDL_Point *point) {
+    return SDL_PointInRect(point, &item->rect) &&
+           isMaskPointSet(params->ingredientsSheet->mask, item->type * INGREDIENT_WIDTH + point->x - item->rect.x, point->y - item->rect.y);
+}
+
+// Whether any opaque pixel of the ingredient is over the cutting board
+static int isIngredientOnCuttingBoard(const GameSceneParams *params, const GameSceneIngredient *item) {
+    SDL_Rect area;
+    if (!SDL_IntersectRect(&item->rect, &dragTargetRect, &area)) {
+        return 0;
+    }
+    // Move the overlapping area into the ingredient's cell in the sheet
+    area.x += item->type * INGREDIENT_WIDTH - item->rect.x;
+    area.y -= item->rect.y;
+    return maskOverlapsRect(params->ingredientsSheet->mask, &area);
+}
+
 static void freeGameScene(Scene *scene) {
     GameSceneParams *params = scene->params;
     freeImage(params->cookButton.image);
     freeImage(params->eyesSheet);
     freeImage(params->ingredientsSheet);
-    // Restore frame count to correctly free all textures
-    params->idleAnimation->frameCount *= 2;
     freeAnimation(params->idleAnimation);
     freeAnimation(params->actionAnimation);
-    for (int i = 0; i < INGREDIENT_QUEUE; i++) {
-        unsetGameSceneIngredient(params, i);
+    if (params->layer) {
+        SDL_DestroyTexture(params->layer);
     }
-    SDL_free(params->counts);
-    SDL_free(params->typesQueue);
-    SDL_free(params);
 
-    if (scene->music) {
-        Mix_FreeMusic(scene->music);
+    freeArena(scene->arena);
+}
+
+// The layer is recreated and redrawn on the next draw
+static void renderResetGameScene(Scene *scene) {
+    GameSceneParams *params = scene->params;
+    if (params->layer) {
+        SDL_DestroyTexture(params->layer);
+        params->layer = NULL;
     }
+}
+
+// Eye sheet row of every eye blit, the same for both eyes
+static const int eyeSheetRows[EYE_BLITS] = { 0, 32, 64, 64, 0, 32, 64, 64 };
+
+// Compute where the eye blits go when looking at the rect, done once per update instead of every draw
+static void computeEyePositions(const SDL_Rect *lookAtRect, int isAltIdleImage, SDL_Point *eyes) {
+    static const int eyeX[2] = { 119, 150 };
+    static const int centerX[2] = { 130, 160 };
+    static const int highlightX[2] = { 132, 163 };
+    int offsetY = isAltIdleImage ? 3 : 0;
+
+    for (int i = 0; i < 2; i++) {
+        double dx = (double)(lookAtRect->x + lookAtRect->w / 2 - centerX[i] - offsetY);
+        double dy = (double)(lookAtRect->y + lookAtRect->h / 2 - 100);
+        double angle = SDL_atan2(dy, dx);
+        double distance = SDL_sqrt(dx * dx + dy * dy);
+        double clampedX = SDL_cos(angle) * SDL_min(distance, 8);
+        double clampedY = SDL_sin(angle) * SDL_min(distance, 8);
 
-    SDL_SetCursor(SDL_GetDefaultCursor());
-    SDL_free(scene);
+        SDL_Point *eye = &eyes[i * 4];
+        // Eye
+        eye[0].x = eyeX[i] + (int)clampedX;
+        eye[0].y = 82 + offsetY + (int)clampedY;
+        // Pupil
+        eye[1].x = eyeX[i] + (int)(clampedX * 1.25);
+        eye[1].y = 82 + offsetY + (int)(clampedY * 1.5);
+        // Highlights
+        eye[2] = eye[0];
+        eye[3].x = highlightX[i] + 8 + (int)(clampedX * 2);
+        eye[3].y = eye[0].y;
+    }
 }
 
-static void drawGameScene(SDL_Renderer *renderer, Scene *scene) {
+static void snapshotGameScene(Scene *scene, SceneSnapshot *snapshot) {
     GameSceneParams *params = scene->params;
-    // White background
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderFillRect(renderer, NULL);
+    GameSceneSnapshot *gameSnapshot = (GameSceneSnapshot *)snapshot;
+    simpleSnapshotScene(scene, snapshot);
+    snapshot->isFullScreen = 0;
+    if (scene->playhead.animation == params->idleAnimation && params->isAltIdleImage) {
+        // Apply the beat animation for the idle animation
+        snapshot->frame += scene->playhead.frameCount;
+    }
+    gameSnapshot->buttonHidden = params->cookButton.hidden;
+    gameSnapshot->buttonPressed = params->cookButton.pressed;
 
     // Look at the item being dragged
     GameSceneIngredient *lookAtItem = params->draggingIngredient;
@@ -159,92 +259,92 @@ static void drawGameScene(SDL_Renderer *renderer, Scene *scene) {
         }
     }
 
+    gameSnapshot->hasEyes = lookAtItem != NULL;
     if (lookAtItem) {
-        SDL_Rect *itemRect = &lookAtItem->rect;
-        int eyeWidth = params->eyesSheet->width;
-        int offsetY = params->isAltIdleImage ? 3 : 0;
+        computeEyePositions(&lookAtItem->rect, params->isAltIdleImage, gameSnapshot->eyes);
+    }
+    else {
+        SDL_memset(gameSnapshot->eyes, 0, sizeof(gameSnapshot->eyes));
+    }
 
-        // Left eye
-        double dx = (double)(itemRect->x + itemRect->w / 2 - 130 - offsetY);
-        double dy = (double)(itemRect->y + itemRect->h / 2 - 100);
-        double angle = SDL_atan2(dy, dx);
-        double distance = SDL_sqrt(dx * dx + dy * dy);
-        double clampedX = SDL_cos(angle) * SDL_min(distance, 8);
-        double clampedY = SDL_sin(angle) * SDL_min(distance, 8);
+    gameSnapshot->ingredientsCount = 0;
+    for (int i = 0; i < INGREDIENT_QUEUE; i++) {
+        GameSceneIngredient *item = params->ingredients[i];
+        if (item) {
+            GameSceneSnapshotIngredient *snapshotItem = &gameSnapshot->ingredients[gameSnapshot->ingredientsCount++];
+            snapshotItem->type = item->type;
+            snapshotItem->rect = item->rect;
+        }
+    }
+}
+
+static void drawGameSceneLayer(SDL_Renderer *renderer, GameSceneParams *params, const GameSceneSnapshot *gameSnapshot, SDL_Texture *frame) {
+    // White background
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderFillRect(renderer, NULL);
 
-        SDL_Rect eyeSrc = { 0, 0, eyeWidth, 32 };
-        SDL_Rect eyeDst = { 0, 0, eyeWidth, 32 };
-        SDL_Texture *texture = params->eyesSheet->texture;
-        eyeDst.x = 119 + (int)clampedX;
-        eyeDst.y = 82 + offsetY + (int)clampedY;
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-
-        eyeSrc.y = 32;
-        eyeDst.x = 119 + (int)(clampedX * 1.25);
-        eyeDst.y = 82 + offsetY + (int)(clampedY * 1.5);
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-
-        //  Left eye highlights
-        eyeSrc.y = 64;
-        eyeDst.x = 119 + (int)clampedX;
-        eyeDst.y = 82 + offsetY + (int)clampedY;
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-        eyeDst.x = 132 + 8 + (int)(clampedX * 2);
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-
-        // Right eye
-        dx = (double)(itemRect->x + itemRect->w / 2 - 160 - offsetY);
-        dy = (double)(itemRect->y + itemRect->h / 2 - 100);
-        angle = SDL_atan2(dy, dx);
-        distance = SDL_sqrt(dx * dx + dy * dy);
-        clampedX = SDL_cos(angle) * SDL_min(distance, 8);
-        clampedY = SDL_sin(angle) * SDL_min(distance, 8);
-
-        eyeSrc.y = 0;
-        eyeDst.x = 150 + (int)(clampedX);
-        eyeDst.y = 82 + offsetY + (int)(clampedY);
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-
-        eyeSrc.y = 32;
-        eyeDst.x = 150 + (int)(clampedX * 1.25);
-        eyeDst.y = 82 + offsetY + (int)(clampedY * 1.5);
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-
-        // Right eye highlights
-        eyeSrc.y = 64;
-        eyeDst.x = 150 + (int)clampedX;
-        eyeDst.y = 82 + offsetY + (int)clampedY;
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
-        eyeDst.x = 163 + 8 + (int)(clampedX * 2);
-        SDL_RenderCopy(renderer, texture, &eyeSrc, &eyeDst);
+    if (gameSnapshot->hasEyes) {
+        int eyeWidth = params->eyesSheet->width;
+        for (int i = 0; i < EYE_BLITS; i++) {
+            SDL_Rect eyeSrc = { 0, eyeSheetRows[i], eyeWidth, 32 };
+            SDL_Rect eyeDst = { gameSnapshot->eyes[i].x, gameSnapshot->eyes[i].y, eyeWidth, 32 };
+            SDL_RenderCopy(renderer, params->eyesSheet->texture, &eyeSrc, &eyeDst);
+        }
     }
 
     // Scene
-    int frame = scene->animation->currentFrame;
-    if (scene->animation == params->idleAnimation && params->isAltIdleImage) {
-        // Apply the beat animation for the idle animation
-        frame += params->idleAnimation->frameCount;
+    SDL_RenderCopy(renderer, frame, NULL, NULL);
+}
+
+static void drawGameScene(SDL_Renderer *renderer, Scene *scene, const SceneSnapshot *snapshot) {
+    GameSceneParams *params = scene->params;
+    const GameSceneSnapshot *gameSnapshot = (const GameSceneSnapshot *)snapshot;
+    SDL_Texture *frame = snapshot->animation->textures[snapshot->frame];
+
+    if (!params->layer) {
+        params->layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, snapshot->animation->width, snapshot->animation->height);
+        params->layerFrame = NULL;
+        if (params->layer) {
+            // The white background makes the layer opaque
+            SDL_SetTextureBlendMode(params->layer, SDL_BLENDMODE_NONE);
+        }
     }
-    SDL_RenderCopy(renderer, scene->animation->textures[frame], NULL, NULL);
 
-    // Ingredients
-    for (int i = 0; i < INGREDIENT_QUEUE; i++) {
-        GameSceneIngredient *item = params->ingredients[i];
-        if (item) {
-            SDL_Rect srcRect = { item->type * INGREDIENT_WIDTH, 0, item->rect.w, item->rect.h };
-            SDL_RenderCopy(renderer, params->ingredientsSheet->texture, &srcRect, &item->rect);
+    if (!params->layer) {
+        // Render targets aren't available, draw everything every frame
+        drawGameSceneLayer(renderer, params, gameSnapshot, frame);
+    }
+    else {
+        if (params->layerFrame != frame || params->layerHasEyes != gameSnapshot->hasEyes ||
+            SDL_memcmp(params->layerEyes, gameSnapshot->eyes, sizeof(params->layerEyes)) != 0) {
+            SDL_Texture *target = SDL_GetRenderTarget(renderer);
+            SDL_SetRenderTarget(renderer, params->layer);
+            drawGameSceneLayer(renderer, params, gameSnapshot, frame);
+            SDL_SetRenderTarget(renderer, target);
+
+            params->layerFrame = frame;
+            params->layerHasEyes = gameSnapshot->hasEyes;
+            SDL_memcpy(params->layerEyes, gameSnapshot->eyes, sizeof(params->layerEyes));
         }
+        SDL_RenderCopy(renderer, params->layer, NULL, NULL);
+    }
+
+    // Ingredients
+    for (int i = 0; i < gameSnapshot->ingredientsCount; i++) {
+        const GameSceneSnapshotIngredient *item = &gameSnapshot->ingredients[i];
+        SDL_Rect srcRect = { item->type * INGREDIENT_WIDTH, 0, item->rect.w, item->rect.h };
+        SDL_RenderCopy(renderer, params->ingredientsSheet->texture, &srcRect, &item->rect);
     }
 
     // Continue button
-    if (!params->cookButton.hidden) {
-        drawUIButton(renderer, &params->cookButton);
+    if (!gameSnapshot->buttonHidden) {
+        drawUIButton(renderer, &params->cookButton, gameSnapshot->buttonPressed);
     }
 
     // Fade out mask
-    if (scene->fadeOutStart) {
+    if (snapshot->fading) {
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255 - scene->alpha);
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255 - snapshot->alpha);
         SDL_RenderFillRect(renderer, NULL);
     }
 }
@@ -253,14 +353,14 @@ static void gameSceneMouseDown(Scene *scene, int x, int y) {
     GameSceneParams *params = scene->params;
     params->cursor.x = x;
     params->cursor.y = y;
-    if (!params->cookButton.hidden && SDL_PointInRect(&params->cursor, &params->cookButton.rect)) {
+    if (!params->cookButton.hidden && isPointOnUIButton(&params->cookButton, &params->cursor)) {
         // Is pressing the continue button
         params->cookButton.pressed = 1;
     }
     else {
         for (int i = INGREDIENT_QUEUE - 1; i >= 0; i--) {
             GameSceneIngredient *item = params->ingredients[i];
-            if (item && SDL_PointInRect(&params->cursor, &item->rect)) {
+            if (item && isPointOnIngredient(params, item, &params->cursor)) {
                 // Is pressing a floating ingredient, start dragging
                 params->draggingIngredient = item;
                 params->dragOffset.x = x - item->rect.x;
@@ -275,7 +375,7 @@ static void gameSceneMouseUp(Scene *scene, int x, int y) {
     GameSceneParams *params = scene->params;
     if (params->cookButton.pressed) {
         params->cookButton.pressed = 0;
-        if (SDL_PointInRect(&params->cursor, &params->cookButton.rect)) {
+        if (isPointOnUIButton(&params->cookButton, &params->cursor)) {
             // Released on the continue button
             params->finished = 1;
         }
@@ -288,8 +388,7 @@ static void gameSceneMouseUp(Scene *scene, int x, int y) {
             item->rect.x = INGREDIENT_MAX_X;
         }
 
-        SDL_Point point = { item->rect.x, item->rect.y };
-        if (scene->animation == params->idleAnimation && SDL_PointInRect(&point, &dragTargetRect)) {
+        if (scene->playhead.animation == params->idleAnimation && isIngredientOnCuttingBoard(params, item)) {
             // On the cutting board, remove the dragging item, hide the continue button, and switch to the cutting animation
             params->counts[item->type]++;
             params->cookButton.hidden = 1;
@@ -299,8 +398,7 @@ static void gameSceneMouseUp(Scene *scene, int x, int y) {
                     break;
                 }
             }
-            resetAnimation(params->actionAnimation);
-            scene->animation = params->actionAnimation;
+            initPlayhead(&scene->playhead, params->actionAnimation, 0, params->actionAnimation->frameCount);
         }
         else {
             // Not on the cutting board, restore position
@@ -332,14 +430,13 @@ static Scene *(*updateGameScene(Scene *scene, int delta, Uint64 time))(SDL_Rende
     Uint64 relativeTime = time - scene->startTime + 300;
     params->isAltIdleImage = (relativeTime * 2 * 134 / 60000) % 2 == 0;
 
-    if (scene->animation == params->actionAnimation && isAnimationEnded(scene->animation, delta)) {
+    if (scene->playhead.animation == params->actionAnimation && isAnimationEnded(&scene->playhead, delta)) {
         // When the cutting animation is finished, show the continue button and switch back to idle animation
         params->cookButton.hidden = 0;
-        resetAnimation(params->idleAnimation);
-        scene->animation = params->idleAnimation;
+        initIdlePlayhead(&scene->playhead, params->idleAnimation);
     }
     else {
-        updateAnimation(scene->animation, delta);
+        updateAnimation(&scene->playhead, delta);
     }
 
     int isHandCursor = 0;
@@ -350,7 +447,7 @@ static Scene *(*updateGameScene(Scene *scene, int delta, Uint64 time))(SDL_Rende
     else {
         // Hovering on the continue button
         if (!params->cookButton.hidden) {
-            if (params->cookButton.pressed || SDL_PointInRect(&params->cursor, &params->cookButton.rect)) {
+            if (params->cookButton.pressed || isPointOnUIButton(&params->cookButton, &params->cursor)) {
                 isHandCursor = 1;
             }
         }
@@ -378,7 +475,7 @@ static Scene *(*updateGameScene(Scene *scene, int delta, Uint64 time))(SDL_Rende
                     // Outside the screen, remove this item
                     unsetGameSceneIngredient(params, i);
                 }
-                else if (SDL_PointInRect(&params->cursor, &item->rect)) {
+                else if (isPointOnIngredient(params, item, &params->cursor)) {
                     // Is hovering on this item
                     isHandCursor = 1;
                 }
@@ -392,48 +489,61 @@ static Scene *(*updateGameScene(Scene *scene, int delta, Uint64 time))(SDL_Rende
         }
     }
 
-    if (params->isHandCursor != isHandCursor) {
-        params->isHandCursor = isHandCursor;
-        SDL_SetCursor(isHandCursor ? g_handCursor : SDL_GetDefaultCursor());
-    }
-
+    scene->isHandCursor = isHandCursor;
     return NULL;
 }
 
 Scene *createGameScene(SDL_Renderer *renderer) {
-    Scene *scene = SDL_malloc(sizeof(Scene));
-    GameSceneParams *params = SDL_malloc(sizeof(GameSceneParams));
-    SDL_zerop(scene);
-    SDL_zerop(params);
+    Scene *scene = allocScene("game");
+    Arena *arena = scene->arena;
+    GameSceneParams *params = arenaAlloc(arena, sizeof(GameSceneParams));
+    params->arena = arena;
 
     AnimatedImage *idleAnimation = loadAnimationWebp(renderer, "images/cooking_idle.webp");
     AnimatedImage *actionAnimation = loadAnimationWebp(renderer, "images/cooking_action.webp");
-    StaticImage *cookButton = loadImageWebp(renderer, "images/button_cook.webp");
-    StaticImage *eyesSheet = loadImageWebp(renderer, "images/eyes_sheet.webp");
-    StaticImage *ingredientsSheet = loadImageWebp(renderer, "images/ingredients_sheet.webp");
+    StaticImage *cookButton = loadMaskedImageWebp(renderer, arena, "images/button_cook.webp");
+    StaticImage *eyesSheet = loadImageWebp(renderer, arena, "images/eyes_sheet.webp");
+    StaticImage *ingredientsSheet = loadMaskedImageWebp(renderer, arena, "images/ingredients_sheet.webp");
     if (!idleAnimation || !actionAnimation || !cookButton || !eyesSheet || !ingredientsSheet) {
+        // Free what did load, the loaded images are tracked until they are freed
+        if (idleAnimation) {
+            freeAnimation(idleAnimation);
+        }
+        if (actionAnimation) {
+            freeAnimation(actionAnimation);
+        }
+        if (cookButton) {
+            freeImage(cookButton);
+        }
+        if (eyesSheet) {
+            freeImage(eyesSheet);
+        }
+        if (ingredientsSheet) {
+            freeImage(ingredientsSheet);
+        }
+        freeArena(arena);
         return NULL;
     }
 
-    // Use only the first half of the frames to update the animation
-    // The second half of the frames is for the beat animation
-    idleAnimation->frameCount /= 2;
     params->eyesSheet = eyesSheet;
     params->ingredientsSheet = ingredientsSheet;
     params->ingredientsCount = ingredientsSheet->width / INGREDIENT_WIDTH;
-    params->counts = SDL_malloc(params->ingredientsCount * sizeof(*params->counts));
-    params->typesQueue = SDL_malloc(INGREDIENT_PLAIN * sizeof(int));
+    params->counts = arenaAlloc(arena, params->ingredientsCount * sizeof(*params->counts));
+    params->typesQueue = arenaAlloc(arena, INGREDIENT_PLAIN * sizeof(int));
     params->idleAnimation = idleAnimation;
     params->actionAnimation = actionAnimation;
     createUIButton(&params->cookButton, cookButton, 0, 0);
     params->cursor.x = -1;
     params->cursor.y = -1;
 
-    scene->animation = idleAnimation;
-    scene->music = loadAndPlayMusic("sounds/working_loop.ogg", -1);
+    initIdlePlayhead(&scene->playhead, idleAnimation);
+    playSceneMusic("sounds/working_loop.ogg", 1);
+    scene->snapshotSize = sizeof(GameSceneSnapshot);
     scene->update = updateGameScene;
+    scene->snapshot = snapshotGameScene;
     scene->draw = drawGameScene;
     scene->free = freeGameScene;
+    scene->renderReset = renderResetGameScene;
     scene->mouseDown = gameSceneMouseDown;
     scene->mouseUp = gameSceneMouseUp;
     scene->mouseMove = gameSceneMouseMove;
@@ -1,43 +1,44 @@
 #include "scene.h"
 
 static Scene *(*updateGameToOutroScene(Scene *scene, int delta, Uint64 time))(SDL_Renderer *) {
-    AnimatedImage *animation = scene->animation;
+    AnimationPlayhead *playhead = &scene->playhead;
     if (scene->fadeOutStart) {
         if (processFadeOut(scene, time)) {
             return createOutroScene;
         }
     }
 
-    if (isAnimationEnded(animation, delta)) {
-        setAnimationFrame(animation, animation->currentFrame - 9);
+    if (isAnimationEnded(playhead, delta)) {
+        setAnimationFrame(playhead, playhead->currentFrame - 9);
 
-        if (!scene->music || !Mix_PlayingMusic()) {
+        if (!isMusicPlaying()) {
             startFadeOut(scene, time);
         }
     }
     else {
-        updateAnimation(animation, delta);
+        updateAnimation(playhead, delta);
     }
 
     return NULL;
 }
 
 Scene *createGameToOutroScene(SDL_Renderer *renderer) {
-    Scene *scene = SDL_malloc(sizeof(Scene));
-    SDL_zerop(scene);
+    Scene *scene = allocScene("game_to_outro");
 
     AnimatedImage *animation = loadAnimationWebp(renderer, "images/cooking_end.webp");
     if (!animation) {
+        freeArena(scene->arena);
         return NULL;
     }
 
-    scene->animation = animation;
-    scene->music = loadAndPlayMusic("sounds/working_end.ogg", 0);
+    initPlayhead(&scene->playhead, animation, 0, animation->frameCount);
+    playSceneMusic("sounds/working_end.ogg", 0);
     scene->update = updateGameToOutroScene;
+    scene->snapshotSize = sizeof(SceneSnapshot);
+    scene->snapshot = simpleSnapshotScene;
     scene->draw = simpleDrawScene;
     scene->free = simpleFreeScene;
     scene->mouseDown = clickSkipSceneHandler;
-
-    SDL_SetCursor(g_handCursor);
+    scene->isHandCursor = 1;
     return scene;
 }
@@ -1,34 +1,36 @@
 #include "scene.h"
 
 static Scene *(*updateGameOutroScene(Scene *scene, int delta, Uint64 time))(SDL_Renderer *) {
-    AnimatedImage *animation = scene->animation;
+    AnimationPlayhead *playhead = &scene->playhead;
     if (scene->fadeOutStart) {
         if (processFadeOut(scene, time)) {
             return createIntroScene;
         }
     }
-    else if (isAnimationEnded(animation, delta)) {
+    else if (isAnimationEnded(playhead, delta)) {
         startFadeOut(scene, time);
     }
     else {
-        updateAnimation(animation, delta);
+        updateAnimation(playhead, delta);
     }
 
     return NULL;
 }
 
 Scene *createOutroScene(SDL_Renderer *renderer) {
-    Scene *scene = SDL_malloc(sizeof(Scene));
-    SDL_zerop(scene);
+    Scene *scene = allocScene("outro");
 
     AnimatedImage *animation = loadAnimationWebp(renderer, "images/end_poisonous.webp");
     if (!animation) {
+        freeArena(scene->arena);
         return NULL;
     }
 
-    scene->animation = animation;
-    scene->music = loadAndPlayMusic("sounds/outro.ogg", 0);
+    initPlayhead(&scene->playhead, animation, 0, animation->frameCount);
+    playSceneMusic("sounds/outro.ogg", 0);
     scene->update = updateGameOutroScene;
+    scene->snapshotSize = sizeof(SceneSnapshot);
+    scene->snapshot = simpleSnapshotScene;
     scene->draw = simpleDrawScene;
     scene->free = simpleFreeScene;
     return scene;
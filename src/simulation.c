@@ -0,0 +1,164 @@
+#include "simulation.h"
+
+#define UPDATE_RATE        60
+#define INPUT_QUEUE_SIZE   64
+#define SNAPSHOT_DIRTY     4
+
+typedef struct {
+    SimulationInputType type;
+    int x;
+    int y;
+} SimulationInput;
+
+struct Simulation {
+    Scene *scene;
+    SDL_Thread *thread;
+    SDL_atomic_t quit;
+    SDL_atomic_t finished;
+    Scene *(*createNextScene)(SDL_Renderer *);
+
+    // Single producer single consumer queue, the main thread writes and the simulation thread reads
+    SimulationInput inputs[INPUT_QUEUE_SIZE];
+    SDL_atomic_t inputHead;
+    SDL_atomic_t inputTail;
+
+    // Triple buffer of snapshots, the simulation thread owns the back slot, the main thread owns the front slot,
+    // the middle slot is swapped with either of them and marked dirty when a new snapshot is published
+    Uint8 *snapshots;
+    SDL_atomic_t middle;
+    int back;
+    int front;
+    int hasFront;
+};
+
+static SceneSnapshot *getSnapshotSlot(Simulation *simulation, int index) {
+    return (SceneSnapshot *)(simulation->snapshots + index * simulation->scene->snapshotSize);
+}
+
+static void publishSnapshot(Simulation *simulation) {
+    Scene *scene = simulation->scene;
+    scene->snapshot(scene, getSnapshotSlot(simulation, simulation->back));
+    // Make sure the snapshot is written before the main thread can see it
+    SDL_MemoryBarrierRelease();
+    simulation->back = SDL_AtomicSet(&simulation->middle, simulation->back | SNAPSHOT_DIRTY) & ~SNAPSHOT_DIRTY;
+}
+
+static void processInputs(Simulation *simulation) {
+    Scene *scene = simulation->scene;
+    int head = SDL_AtomicGet(&simulation->inputHead);
+    int tail = SDL_AtomicGet(&simulation->inputTail);
+    SDL_MemoryBarrierAcquire();
+
+    while (head != tail) {
+        SimulationInput *input = &simulation->inputs[head];
+        switch (input->type) {
+        case SIMULATION_MOUSE_DOWN:
+            if (scene->mouseDown) {
+                scene->mouseDown(scene, input->x, input->y);
+            }
+            break;
+        case SIMULATION_MOUSE_UP:
+            if (scene->mouseUp) {
+                scene->mouseUp(scene, input->x, input->y);
+            }
+            break;
+        case SIMULATION_MOUSE_MOVE:
+            if (scene->mouseMove) {
+                scene->mouseMove(scene, input->x, input->y);
+            }
+            break;
+        }
+        head = (head + 1) % INPUT_QUEUE_SIZE;
+    }
+
+    // Release the slots only after they are read
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&simulation->inputHead, head);
+}
+
+static int simulationThread(void *data) {
+    Simulation *simulation = data;
+    Scene *scene = simulation->scene;
+    Uint64 lastTicks = SDL_GetTicks64();
+
+    // Publish the initial state so the main thread has something to draw right away
+    publishSnapshot(simulation);
+
+    while (!SDL_AtomicGet(&simulation->quit)) {
+        Uint64 currentTicks = SDL_GetTicks64();
+        int delta = currentTicks - lastTicks;
+        if (delta < 1000 / UPDATE_RATE) {
+            SDL_Delay(1000 / UPDATE_RATE - delta);
+            continue;
+        }
+        lastTicks = currentTicks;
+
+        processInputs(simulation);
+        Scene *(*createNextScene)(SDL_Renderer *) = scene->update(scene, delta, currentTicks);
+        if (createNextScene) {
+            // Creating the next scene needs the renderer, so leave it to the main thread
+            simulation->createNextScene = createNextScene;
+            break;
+        }
+        publishSnapshot(simulation);
+    }
+
+    SDL_AtomicSet(&simulation->finished, 1);
+    return 0;
+}
+
+Simulation *startSimulation(Scene *scene) {
+    // Both live as long as the scene, the arena is only used by the simulation thread after this
+    Simulation *simulation = arenaAlloc(scene->arena, sizeof(Simulation));
+    simulation->scene = scene;
+    simulation->snapshots = arenaAlloc(scene->arena, scene->snapshotSize * 3);
+    simulation->front = 0;
+    simulation->back = 2;
+    SDL_AtomicSet(&simulation->middle, 1);
+
+    simulation->thread = SDL_CreateThread(simulationThread, "simulation", simulation);
+    if (!simulation->thread) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create simulation thread: %s", SDL_GetError());
+        return NULL;
+    }
+    return simulation;
+}
+
+void postSimulationInput(Simulation *simulation, SimulationInputType type, int x, int y) {
+    int tail = SDL_AtomicGet(&simulation->inputTail);
+    int next = (tail + 1) % INPUT_QUEUE_SIZE;
+    if (next == SDL_AtomicGet(&simulation->inputHead)) {
+        // The simulation thread is falling behind, drop the input
+        return;
+    }
+    SDL_MemoryBarrierAcquire();
+
+    SimulationInput *input = &simulation->inputs[tail];
+    input->type = type;
+    input->x = x;
+    input->y = y;
+
+    // Make sure the input is written before the simulation thread can see it
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&simulation->inputTail, next);
+}
+
+const SceneSnapshot *acquireSimulationSnapshot(Simulation *simulation) {
+    if (SDL_AtomicGet(&simulation->middle) & SNAPSHOT_DIRTY) {
+        simulation->front = SDL_AtomicSet(&simulation->middle, simulation->front) & ~SNAPSHOT_DIRTY;
+        SDL_MemoryBarrierAcquire();
+        simulation->hasFront = 1;
+    }
+    return simulation->hasFront ? getSnapshotSlot(simulation, simulation->front) : NULL;
+}
+
+int isSimulationFinished(Simulation *simulation) {
+    return SDL_AtomicGet(&simulation->finished);
+}
+
+Scene *(*stopSimulation(Simulation *simulation))(SDL_Renderer *) {
+    SDL_AtomicSet(&simulation->quit, 1);
+    SDL_WaitThread(simulation->thread, NULL);
+
+    return simulation->createNextScene;
+}
@@ -0,0 +1,20 @@
+#ifndef APP_SIMULATION_h
+#define APP_SIMULATION_h
+
+#include "scene.h"
+
+typedef enum {
+    SIMULATION_MOUSE_DOWN,
+    SIMULATION_MOUSE_UP,
+    SIMULATION_MOUSE_MOVE,
+} SimulationInputType;
+
+typedef struct Simulation Simulation;
+
+Simulation *startSimulation(Scene *scene);
+void postSimulationInput(Simulation *simulation, SimulationInputType type, int x, int y);
+const SceneSnapshot *acquireSimulationSnapshot(Simulation *simulation);
+int isSimulationFinished(Simulation *simulation);
+Scene *(*stopSimulation(Simulation *simulation))(SDL_Renderer *);
+
+#endif
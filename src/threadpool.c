@@ -0,0 +1,111 @@
+#include "threadpool.h"
+
+#define MAX_WORKERS 15
+
+static struct {
+    int workerCount;
+    SDL_Thread *workers[MAX_WORKERS];
+    SDL_sem *start;
+    SDL_sem *done;
+    SDL_mutex *lock;
+    SDL_atomic_t quit;
+
+    // The job currently running, written by the calling thread before waking the workers
+    void (*function)(int, void *);
+    void *data;
+    int count;
+    SDL_atomic_t next;
+} pool;
+
+static void runJob(void) {
+    for (;;) {
+        int index = SDL_AtomicAdd(&pool.next, 1);
+        if (index >= pool.count) {
+            break;
+        }
+        pool.function(index, pool.data);
+    }
+}
+
+static int workerThread(void *data) {
+    for (;;) {
+        SDL_SemWait(pool.start);
+        if (SDL_AtomicGet(&pool.quit)) {
+            break;
+        }
+        runJob();
+        SDL_SemPost(pool.done);
+    }
+    return 0;
+}
+
+void initThreadPool(void) {
+    // The calling thread also takes part in the work
+    int workerCount = SDL_min(SDL_GetCPUCount() - 1, MAX_WORKERS);
+    pool.start = SDL_CreateSemaphore(0);
+    pool.done = SDL_CreateSemaphore(0);
+    pool.lock = SDL_CreateMutex();
+    if (!pool.start || !pool.done || !pool.lock) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create thread pool: %s", SDL_GetError());
+        return;
+    }
+
+    for (int i = 0; i < workerCount; i++) {
+        SDL_Thread *thread = SDL_CreateThread(workerThread, "worker", NULL);
+        if (!thread) {
+            SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Couldn't create worker thread: %s", SDL_GetError());
+            break;
+        }
+        pool.workers[pool.workerCount++] = thread;
+    }
+}
+
+void quitThreadPool(void) {
+    SDL_AtomicSet(&pool.quit, 1);
+    for (int i = 0; i < pool.workerCount; i++) {
+        SDL_SemPost(pool.start);
+    }
+    for (int i = 0; i < pool.workerCount; i++) {
+        SDL_WaitThread(pool.workers[i], NULL);
+    }
+    pool.workerCount = 0;
+
+    if (pool.start) {
+        SDL_DestroySemaphore(pool.start);
+        SDL_DestroySemaphore(pool.done);
+        SDL_DestroyMutex(pool.lock);
+        pool.start = NULL;
+        pool.done = NULL;
+        pool.lock = NULL;
+    }
+}
+
+int getThreadPoolSize(void) {
+    return pool.workerCount + 1;
+}
+
+// Call function(i, data) for every i in [0, count) and wait until all of them are done
+void parallelFor(int count, void (*function)(int, void *), void *data) {
+    if (count <= 1 || pool.workerCount == 0 || SDL_TryLockMutex(pool.lock) != 0) {
+        // Not worth waking the workers, or another thread is already using them
+        for (int i = 0; i < count; i++) {
+            function(i, data);
+        }
+        return;
+    }
+
+    int wakeCount = SDL_min(count - 1, pool.workerCount);
+    pool.function = function;
+    pool.data = data;
+    pool.count = count;
+    SDL_AtomicSet(&pool.next, 0);
+    for (int i = 0; i < wakeCount; i++) {
+        SDL_SemPost(pool.start);
+    }
+
+    runJob();
+    for (int i = 0; i < wakeCount; i++) {
+        SDL_SemWait(pool.done);
+    }
+    SDL_UnlockMutex(pool.lock);
+}
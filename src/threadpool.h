@@ -0,0 +1,11 @@
+#ifndef APP_THREADPOOL_h
+#define APP_THREADPOOL_h
+
+#include <SDL2/SDL.h>
+
+void initThreadPool(void);
+void quitThreadPool(void);
+int getThreadPoolSize(void);
+void parallelFor(int count, void (*function)(int, void *), void *data);
+
+#endif